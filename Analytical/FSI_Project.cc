@@ -135,6 +135,8 @@ namespace FSI_Project
     void assemble_fluid (Mode enum_);
     void assemble_structure(Mode enum_);
     void assemble_ale(Mode enum_);
+    void ale_state_boundary_values(std::map<types::global_dof_index,double> &ale_boundary_values);
+    void ale_state_solve();
     void build_adjoint_rhs();
     double interface_error();
     void dirichlet_boundaries(System system, Mode enum_);
@@ -153,6 +155,12 @@ namespace FSI_Project
 
     BlockSparsityPattern       sparsity_pattern;
     BlockSparseMatrix<double> system_matrix;
+    // Direct solvers of the diagonal blocks, kept across solves and separate for the state and
+    // adjoint systems, which share system_matrix. The fluid and structure blocks are reassembled
+    // before every solve and refactored; the ALE block is factored once in ale_state_solve.
+    std::vector<SparseDirectUMFPACK> state_solver, adjoint_solver;
+    // ALE Laplacian before boundary values are applied, kept to build the lifting of the boundary values
+    SparseMatrix<double> ale_matrix_unconstrained;
 
     BlockVector<double>       	solution;
     BlockVector<double>			state_solution_for_rhs;
@@ -268,7 +276,9 @@ namespace FSI_Project
     errors(),
     n_blocks(5),
     n_big_blocks(3),
-    dofs_per_block(5)
+    dofs_per_block(5),
+    state_solver(3),
+    adjoint_solver(3)
   {
 	  fem_properties.fluid_degree		= prm_.get_integer("fluid velocity degree");
 	  fem_properties.pressure_degree	= prm_.get_integer("fluid pressure degree");
@@ -1663,6 +1673,66 @@ namespace FSI_Project
 	  }
   }
 
+  template <int dim>
+  void FSIProblem<dim>::ale_state_boundary_values (std::map<types::global_dof_index,double> &ale_boundary_values)
+  {
+	const FEValuesExtractors::Vector ale_displacement (0);
+	for (unsigned int i=0; i<4; ++i)
+	{
+			if (ale_boundaries[i]==Dirichlet)
+			{
+				VectorTools::interpolate_boundary_values (ale_dof_handler,
+														  i,
+														  ZeroFunction<dim>(dim),
+														  ale_boundary_values,
+														  ale_fe.component_mask(ale_displacement));
+			}
+	}
+	// The interface follows the structure displacement, also where it meets a Dirichlet side
+	for (unsigned int i=0; i<dofs_per_big_block[2]; ++i)
+	{
+		if (a2s.count(i))
+		{
+			ale_boundary_values[i] = solution.block(1)[a2s[i]];
+		}
+	}
+  }
+
+  template <int dim>
+  void FSIProblem<dim>::ale_state_solve ()
+  {
+	// The ALE operator is a vector Laplacian on the reference fluid mesh, so it is assembled,
+	// constrained and factored once. Afterwards only the lifting of the current boundary
+	// values is formed: b_I = -A_IB g, b_B = diag(A_BB) g
+	std::map<types::global_dof_index,double> ale_boundary_values;
+	ale_state_boundary_values(ale_boundary_values);
+
+	if (ale_matrix_unconstrained.empty())
+	{
+		assemble_ale(state);
+		ale_matrix_unconstrained.reinit(sparsity_pattern.block(2,2));
+		ale_matrix_unconstrained.copy_from(system_matrix.block(2,2));
+		MatrixTools::apply_boundary_values (ale_boundary_values,
+											system_matrix.block(2,2),
+											solution.block(2),
+											system_rhs.block(2));
+		state_solver[2].initialize(system_matrix.block(2,2));
+	}
+
+	Vector<double> lifting(dofs_per_big_block[2]);
+	for (std::map<types::global_dof_index,double>::const_iterator it=ale_boundary_values.begin(); it!=ale_boundary_values.end(); ++it)
+	{
+		lifting(it->first) = it->second;
+	}
+	ale_matrix_unconstrained.vmult(system_rhs.block(2), lifting);
+	system_rhs.block(2) *= -1;
+	for (std::map<types::global_dof_index,double>::const_iterator it=ale_boundary_values.begin(); it!=ale_boundary_values.end(); ++it)
+	{
+		system_rhs.block(2)(it->first) = system_matrix.block(2,2).diag_element(it->first)*it->second;
+	}
+	solve(2,state);
+  }
+
   template <int dim>
   void FSIProblem<dim>::dirichlet_boundaries (System system, Mode enum_)
   {
@@ -1716,31 +1786,9 @@ namespace FSI_Project
 		}
 		else
 		{
-			std::map<types::global_dof_index,double> ale_dirichlet_boundary_values;
-			std::map<types::global_dof_index,double> ale_interface_boundary_values;
-			for (unsigned int i=0; i<dofs_per_big_block[2]; ++i)
-			{
-				if (a2s.count(i))
-				{
-					ale_interface_boundary_values.insert(std::pair<unsigned int,double>(i,solution.block(1)[a2s[i]]));
-				}
-			}
-			for (unsigned int i=0; i<4; ++i)
-			{
-					if (ale_boundaries[i]==Dirichlet)
-					{
-						VectorTools::interpolate_boundary_values (ale_dof_handler,
-																  i,
-																  ZeroFunction<dim>(dim),
-																  ale_dirichlet_boundary_values,
-																  ale_fe.component_mask(ale_displacement));
-					}
-			}
-			MatrixTools::apply_boundary_values (ale_dirichlet_boundary_values,
-												system_matrix.block(2,2),
-												solution.block(2),
-												system_rhs.block(2));
-			MatrixTools::apply_boundary_values (ale_interface_boundary_values,
+			std::map<types::global_dof_index,double> ale_boundary_values;
+			ale_state_boundary_values(ale_boundary_values);
+			MatrixTools::apply_boundary_values (ale_boundary_values,
 												system_matrix.block(2,2),
 												solution.block(2),
 												system_rhs.block(2));
@@ -2005,6 +2053,7 @@ namespace FSI_Project
     sparsity_pattern.copy_from (csp);
 
     system_matrix.reinit (sparsity_pattern);
+    ale_matrix_unconstrained.clear();
 
     solution.reinit (n_big_blocks);
     state_solution_for_rhs.reinit(n_big_blocks);
@@ -2044,8 +2093,18 @@ namespace FSI_Project
   template <int dim>
   void FSIProblem<dim>::solve (const int block_num, Mode enum_)
   {
-	SparseDirectUMFPACK direct_solver;
-	direct_solver.initialize (system_matrix.block(block_num,block_num));
+	SparseDirectUMFPACK &direct_solver = (enum_==state) ? state_solver[block_num] : adjoint_solver[block_num];
+	if (block_num==2)
+	{
+		// factored once by ale_state_solve
+		AssertThrow(enum_==state && !ale_matrix_unconstrained.empty(), ExcNotInitialized());
+	}
+	else
+	{
+		// The block was just reassembled. SparseDirectUMFPACK::factorize repeats the symbolic
+		// analysis as well, so keeping the solver only saves its setup, not the analysis.
+		direct_solver.factorize (system_matrix.block(block_num,block_num));
+	}
 	BlockVector<double> *solution_vector;
 	if (enum_==state)
 	{
@@ -2335,13 +2394,13 @@ namespace FSI_Project
 			// Solve for the state variables
 			assemble_structure(state);
 			assemble_fluid(state);
-			assemble_ale(state);
-			// This solving order will need changed later since the Dirichlet bcs for the ALE depend on the solution to the structure problem
-			for (unsigned int i=0; i<3; ++i)
+			for (unsigned int i=0; i<2; ++i)
 			{
 				dirichlet_boundaries((System)i,state);
 				solve(i,state);
 			}
+			// The Dirichlet values of the ALE come from the structure solution
+			ale_state_solve();
 
 			build_adjoint_rhs();
 			velocity_jump_old = velocity_jump;
@@ -2353,7 +2412,6 @@ namespace FSI_Project
 
 			assemble_structure(adjoint);
 			assemble_fluid(adjoint);
-			assemble_ale(adjoint);
 			// Solve for the adjoint
 			for (unsigned int i=0; i<2; ++i)
 			{
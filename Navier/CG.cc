@@ -136,8 +136,11 @@ unsigned int FSIProblem<dim>::optimization_CG (unsigned int total_solves, const
 
   // get adjoint variables
   // timer.enter_subsection ("Assemble"); 
-  s_assembly = Threads::new_task(&FSIProblem<dim>::assemble_structure, *this, adjoint, true);
-  f_assembly = Threads::new_task(&FSIProblem<dim>::assemble_fluid, *this, adjoint, true);
+  // With transposed adjoint solves only the right hand side is needed, the factors of the
+  // linearized matrices from above are reused
+  std::vector<SparseDirectUMFPACK> &adjoint_factors = fem_properties.transposed_adjoint ? linear_solver : adjoint_solver;
+  s_assembly = Threads::new_task(&FSIProblem<dim>::assemble_structure, *this, adjoint, !fem_properties.transposed_adjoint);
+  f_assembly = Threads::new_task(&FSIProblem<dim>::assemble_fluid, *this, adjoint, !fem_properties.transposed_adjoint);
   f_assembly.join();
   dirichlet_boundaries((System)0,adjoint);
   s_assembly.join();
@@ -145,7 +148,12 @@ unsigned int FSIProblem<dim>::optimization_CG (unsigned int total_solves, const
   // timer.leave_subsection ();
 	      
   // timer.enter_subsection ("Linear Solve");
-  if (timestep_number==1) {
+  if (fem_properties.transposed_adjoint) {
+    Threads::Task<void> f_solve = Threads::new_task(&FSIProblem<dim>::solve,*this,adjoint_factors[0],0,adjoint);
+    Threads::Task<void> s_solve = Threads::new_task(&FSIProblem<dim>::solve,*this,adjoint_factors[1],1,adjoint);
+    f_solve.join();
+    s_solve.join();
+  } else if (timestep_number==1) {
     adjoint_solver[0].initialize(adjoint_matrix.block(0,0));
     adjoint_solver[1].initialize(adjoint_matrix.block(1,1));
     Threads::Task<void> f_solve = Threads::new_task(&FSIProblem<dim>::solve,*this,adjoint_solver[0],0,adjoint);
@@ -287,8 +295,8 @@ unsigned int FSIProblem<dim>::optimization_CG (unsigned int total_solves, const
       // timer.leave_subsection ();
 	      
       // timer.enter_subsection ("Linear Solve");	      
-      f_solve = Threads::new_task(&FSIProblem<dim>::solve,*this,adjoint_solver[0],0,adjoint);
-      s_solve = Threads::new_task(&FSIProblem<dim>::solve,*this,adjoint_solver[1],1,adjoint);				
+      f_solve = Threads::new_task(&FSIProblem<dim>::solve,*this,adjoint_factors[0],0,adjoint);
+      s_solve = Threads::new_task(&FSIProblem<dim>::solve,*this,adjoint_factors[1],1,adjoint);				
       f_solve.join();
       s_solve.join();
       // timer.leave_subsection ();		
@@ -21,6 +21,10 @@
 #include <deal.II/lac/sparse_direct.h>
 #include <deal.II/lac/constraint_matrix.h>
 #include <deal.II/lac/precondition.h>
+#include <deal.II/lac/sparse_ilu.h>
+#ifdef DEAL_II_WITH_TRILINOS
+#include <deal.II/lac/trilinos_precondition.h>
+#endif
 #include <deal.II/grid/tria.h>
 #include <deal.II/grid/grid_generator.h>
 #include <deal.II/grid/tria_accessor.h>
@@ -32,6 +36,10 @@
 #include <deal.II/fe/fe_system.h>
 #include <deal.II/fe/fe_q.h>
 #include <deal.II/fe/fe_values.h>
+#include <deal.II/fe/mapping_q1.h>
+#include <deal.II/fe/mapping_q_eulerian.h>
+#include <deal.II/base/std_cxx1x/shared_ptr.h>
+#include <deal.II/base/std_cxx1x/bind.h>
 #include <deal.II/numerics/data_out.h>
 #include <deal.II/numerics/vector_tools.h>
 #include <deal.II/numerics/matrix_tools.h>
@@ -42,6 +50,7 @@
 
 #include <deal.II/base/work_stream.h>
 #include <deal.II/base/multithread_info.h>
+#include <deal.II/base/thread_management.h>
 
 #include <fstream>
 #include <iostream>
@@ -51,8 +60,15 @@
 #include "parameters.h"
 #include "small_classes.h"
 #include "data1.h"
+#include "coupling_acceleration.h"
 //#include "linear_maps.h" 
 
+// Transposed solves with SparseDirectUMFPACK (solve with a transpose flag) exist from deal.II 8.3 on;
+// without them the transposed adjoint mode is not available
+#if DEAL_II_VERSION_MAJOR > 8 || (DEAL_II_VERSION_MAJOR == 8 && DEAL_II_VERSION_MINOR >= 3)
+#define FSI_UMFPACK_TRANSPOSED_SOLVE
+#endif
+
 using namespace dealii;
 
 #ifndef LINEAR_MAPS_H
@@ -62,6 +78,12 @@ namespace LinearMap {
   class Linearized_Operator;
   template<int dim>
   class NeumannVector;
+  template<int dim>
+  class InterfaceVector;
+  template<int dim>
+  class FluidBlockPreconditioner;
+  template<int dim>
+  class MonolithicPreconditioner;
 }
 #endif
 
@@ -112,17 +134,35 @@ class FSIProblem
   void structure_state_solve(unsigned int initialized_timestep_number);
 
   void assemble_fluid (Mode enum_, bool assemble_matrix);
+  template <unsigned int mode_type, bool navier_stokes, bool stability_terms>
   void assemble_fluid_matrix_on_one_cell (const typename DoFHandler<dim>::active_cell_iterator& cell,
-							     FullScratchData<dim>& scratch,
+							     FluidScratchData<dim>& scratch,
 							     PerTaskData<dim>& data );
+  typedef void (FSIProblem<dim>::*FluidCellKernel) (const typename DoFHandler<dim>::active_cell_iterator& cell,
+						     FluidScratchData<dim>& scratch,
+						     PerTaskData<dim>& data );
+  FluidCellKernel fluid_cell_kernel (const Mode enum_) const; // kernel specialization for the current physics
   void copy_local_fluid_to_global (const PerTaskData<dim> &data);
+  void assemble_fluid_stokes_matrix();
+  void assemble_fluid_stokes_on_one_cell (const typename DoFHandler<dim>::active_cell_iterator& cell,
+					  BaseScratchData<dim>& scratch,
+					  PerTaskData<dim>& data );
+  void copy_local_fluid_stokes_to_global (const PerTaskData<dim> &data);
+  void fluid_block_solve(const SparseMatrix<double> &fluid_matrix, Vector<double> &fluid_solution, const Vector<double> &fluid_rhs,
+			 const bool rebuild_preconditioner);
+  void assemble_fluid_pressure_mass_matrix();
 
   void assemble_structure(Mode enum_, bool assemble_matrix);
+  template <unsigned int mode_type, bool nonlinear_elasticity, bool structure_newton>
   void assemble_structure_matrix_on_one_cell (const typename DoFHandler<dim>::active_cell_iterator& cell,
-							     FullScratchData<dim>& scratch,
+							     StructureScratchData<dim>& scratch,
 							     PerTaskData<dim>& data );
+  typedef void (FSIProblem<dim>::*StructureCellKernel) (const typename DoFHandler<dim>::active_cell_iterator& cell,
+							 StructureScratchData<dim>& scratch,
+							 PerTaskData<dim>& data );
+  StructureCellKernel structure_cell_kernel (const Mode enum_) const; // kernel specialization for the current physics
   void assemble_structure_stresses_on_one_cell (const typename DoFHandler<dim>::active_cell_iterator& cell,
-							     FullScratchData<dim>& scratch,
+							     StructureScratchData<dim>& scratch,
 							     PerTaskData<dim>& data );
 
   void copy_local_structure_to_global (const PerTaskData<dim> &data);
@@ -132,6 +172,32 @@ class FSIProblem
 					BaseScratchData<dim> &scratch,
 					PerTaskData<dim> &data);
   void copy_local_ale_to_global (const PerTaskData<dim> &data);
+  void ale_state_solve();
+  void fluid_state_boundary_values(std::map<types::global_dof_index,double> &fluid_boundary_values);
+  void structure_state_boundary_values(std::map<types::global_dof_index,double> &structure_boundary_values);
+  void ale_state_boundary_values(std::map<types::global_dof_index,double> &ale_boundary_values);
+  void linearized_boundary_values(System system, std::map<types::global_dof_index,double> &boundary_values);
+  void setup_monolithic_sparsity();
+  void update_fluid_geometry();
+  void monolithic_state_solve();
+
+  typedef std::vector<std::vector<typename DoFHandler<dim>::active_cell_iterator> > CellColoring;
+  void color_cells (const DoFHandler<dim> &dof_handler, CellColoring &colors);
+  template <class ScratchData>
+  void run_assembly (const DoFHandler<dim> &dof_handler,
+		     const CellColoring &colors,
+		     void (FSIProblem<dim>::*worker) (const typename DoFHandler<dim>::active_cell_iterator&, ScratchData&, PerTaskData<dim>&),
+		     void (FSIProblem<dim>::*copier) (const PerTaskData<dim>&),
+		     const ScratchData &scratch_data,
+		     const PerTaskData<dim> &per_task_data);
+  template <class ScratchData>
+  void assemble_colored_cells (const std::vector<typename DoFHandler<dim>::active_cell_iterator> &cells,
+			       const unsigned int begin,
+			       const unsigned int end,
+			       void (FSIProblem<dim>::*worker) (const typename DoFHandler<dim>::active_cell_iterator&, ScratchData&, PerTaskData<dim>&),
+			       void (FSIProblem<dim>::*copier) (const PerTaskData<dim>&),
+			       const ScratchData &scratch_data,
+			       const PerTaskData<dim> &per_task_data);
 
   unsigned int optimization_CG(unsigned int total_solves, const unsigned int initial_timestep_number);
   unsigned int optimization_BICGSTAB(unsigned int &total_solves, const unsigned int initial_timestep_number, const bool random_initial_guess, const unsigned int max_iterations, const double update_alpha);
@@ -139,21 +205,33 @@ class FSIProblem
 
   void ale_transform_fluid(); // Move the fluid domain by the mesh displacement solution variable
   void ref_transform_fluid(); // Move the transformed fluid domain back to reference by the mesh displacement solution variable
+  void displace_fluid_vertices(const double direction);
+  const Mapping<dim> & fluid_mapping() const; // Mapping to the current fluid configuration for all fluid FEValues
 
   void build_adjoint_rhs();
   void get_fluid_stress();
   Tensor<1,dim> lift_and_drag_fluid();
   Tensor<1,dim> lift_and_drag_structure();
   double interface_error();
-  double interface_norm(const Vector<double>  &values);
-  double interface_inner_product(const Vector<double>   &values1, const Vector<double>   &values2);
+  double interface_functional(const Vector<double> &jump, const Vector<double> &control);
+  void update_coupling_iterate(const BlockVector<double> &previous_iterate);
+  double linearized_line_search(const Vector<double> &step, const double jump_slope, const double jump_curvature,
+				const double alpha_0, const double objective, const double t_val);
+  double coupling_inner_product(const Vector<double> &values1, const Vector<double> &values2) const;
+  void assemble_interface_mass_matrix();
+  void assemble_structure_interface_mass_matrix();
+  void assemble_interface_rhs(Mode enum_);
+  double interface_norm(const Vector<double>  &values) const;
+  double interface_inner_product(const Vector<double>   &values1, const Vector<double>   &values2) const;
   void dirichlet_boundaries(System system, Mode enum_);
   void build_dof_mapping();
+  const InterfaceMap & interface_map(unsigned int from, unsigned int to, StructureComponent structure_var_1=NotSet, StructureComponent structure_var_2=NotSet) const;
   void transfer_interface_dofs(const BlockVector<double> & solution_1, BlockVector<double> & solution_2, unsigned int from, unsigned int to, StructureComponent structure_var_1=NotSet, StructureComponent structure_var_2=NotSet);
   void vector_vector_transfer_interface_dofs(const Vector<double> & solution_1, Vector<double> & solution_2, unsigned int from, unsigned int to, StructureComponent structure_var_1=NotSet, StructureComponent structure_var_2=NotSet);
   void transfer_all_dofs(BlockVector<double> & solution_1, BlockVector<double> & solution_2, unsigned int from, unsigned int to);
   void setup_system ();
   void solve (const SparseDirectUMFPACK& direct_solver, const int block_num, Mode enum_);
+  void lagged_state_solve (const SparseDirectUMFPACK& direct_solver, const int block_num);
   void output_results () const;
   void compute_error ();
 
@@ -163,11 +241,61 @@ class FSIProblem
 
   ConstraintMatrix fluid_constraints, structure_constraints, ale_constraints;
 
+  // Cells of each DoFHandler grouped so that no two cells of a color share a dof,
+  // computed once in setup_system and used by the colored assembly
+  CellColoring fluid_colors, structure_colors, ale_colors;
+
   BlockSparsityPattern       sparsity_pattern;
   BlockSparseMatrix<double>  system_matrix;
   BlockSparseMatrix<double>  adjoint_matrix;
   BlockSparseMatrix<double>  linear_matrix;
 
+  // Maps the reference fluid cells by the ALE displacement held in mesh_displacement_star.block(2)
+  std_cxx1x::shared_ptr<MappingQEulerian<dim> > fluid_eulerian_mapping;
+
+  // Mass, viscous and pressure terms of the fluid operator, shared by all modes and reassembled
+  // only when the fluid geometry (fluid_stokes_displacement) changes
+  SparseMatrix<double>       fluid_stokes_matrix;
+  Vector<double>             fluid_stokes_displacement;
+
+  // Velocity-velocity block of the fluid matrix and the pressure mass matrix (on the
+  // reference mesh), both numbered within their block, for the block preconditioner
+  SparsityPattern            fluid_velocity_sparsity_pattern;
+  SparseMatrix<double>       fluid_velocity_matrix;
+  SparsityPattern            fluid_pressure_sparsity_pattern;
+  SparseMatrix<double>       fluid_pressure_mass_matrix;
+  // The pressure mass matrix does not change and is factored once; the velocity preconditioner
+  // is rebuilt whenever the fluid Jacobian is refreshed (every solve without modified Newton)
+  SparseDirectUMFPACK        fluid_pressure_mass_solver;
+  bool                       fluid_pressure_mass_factored;
+#ifdef DEAL_II_WITH_TRILINOS
+  TrilinosWrappers::PreconditionAMG fluid_velocity_preconditioner;
+#else
+  SparseILU<double>          fluid_velocity_preconditioner;
+#endif
+
+  // ALE Laplacian before boundary values are applied, kept to build the lifting of the interface displacement
+  SparseMatrix<double>       ale_matrix_unconstrained;
+  // Preconditioner of the constrained ALE Laplacian for the iterative ALE solver, built once with it
+#ifdef DEAL_II_WITH_TRILINOS
+  TrilinosWrappers::PreconditionAMG ale_preconditioner;
+#else
+  PreconditionSSOR<SparseMatrix<double> > ale_preconditioner;
+#endif
+  // Factorization of the ALE rows of the monolithic system, the Laplacian with its boundary rows
+  // tied to the structure displacement; it does not change and is factored once
+  SparseDirectUMFPACK        monolithic_ale_solver;
+  bool                       monolithic_ale_factored;
+
+  // Face mass matrix of the interface velocity dofs (numbered as the sources of f2n)
+  // on the current ALE configuration, used for interface inner products and norms
+  SparsityPattern            interface_sparsity_pattern;
+  SparseMatrix<double>       interface_mass_matrix;
+  // Same for the structure dofs in structure_interface_dofs, in the configuration of the
+  // last linearized (or adjoint) structure assembly
+  SparsityPattern            structure_interface_sparsity_pattern;
+  SparseMatrix<double>       structure_interface_mass_matrix;
+
   BlockVector<double>       	solution;
   BlockVector<double>       	solution_star;
   BlockVector<double>		rhs_for_adjoint;
@@ -205,9 +333,16 @@ class FSIProblem
   Parameters::PhysicalProperties physical_properties;
   std::set<unsigned int> fluid_interface_boundaries;
   std::set<unsigned int> structure_interface_boundaries;
-  std::map<unsigned int, unsigned int> f2n, n2f, f2v, v2f, n2a, a2n, a2v, v2a, a2f, f2a, n2v, v2n, a2f_all, f2a_all;
+  InterfaceMap f2n, n2f, f2v, v2f, n2a, a2n, a2v, v2a, a2f, f2a, n2v, v2n, a2f_all, f2a_all;
+  // Structure displacement and velocity dofs seen by the fluid, sorted: the unknowns of the DN iteration
+  std::vector<types::global_dof_index> structure_interface_dofs;
+  // Position in structure_interface_dofs of the structure displacement dof matched to each f2n source
+  std::vector<unsigned int> interface_displacement_index;
+  CouplingAccelerator coupling_accelerator;
   std::map<unsigned int, BoundaryCondition> fluid_boundaries, structure_boundaries, ale_boundaries;
   std::vector<SparseDirectUMFPACK > state_solver,  adjoint_solver,  linear_solver;
+  // Decide when the factors in state_solver[0] and state_solver[1] are renewed with modified newton
+  JacobianMonitor fluid_jacobian, structure_jacobian;
 
   unsigned int master_thread;
   bool update_domain;
@@ -216,6 +351,9 @@ class FSIProblem
   friend class LinearMap::Wilkinson;
   friend class LinearMap::Linearized_Operator<dim>;
   friend class LinearMap::NeumannVector<dim>;
+  friend class LinearMap::InterfaceVector<dim>;
+  friend class LinearMap::FluidBlockPreconditioner<dim>;
+  friend class LinearMap::MonolithicPreconditioner<dim>;
 };
 
 
@@ -231,6 +369,8 @@ fluid_fe (FE_Q<dim>(prm_.get_integer("fluid velocity degree")), dim,
   fluid_dof_handler (fluid_triangulation),
   structure_dof_handler (structure_triangulation),
   ale_dof_handler (fluid_triangulation),
+  fluid_pressure_mass_factored(false),
+  monolithic_ale_factored(false),
   time_step ((prm_.get_double("T")-prm_.get_double("t0"))/prm_.get_integer("number of time steps")),
   timestep_number(timestep_number_),
   errors(),
@@ -275,12 +415,32 @@ fluid_fe (FE_Q<dim>(prm_.get_integer("fluid velocity degree")), dim,
   fem_properties.true_control           = prm_.get_bool("true control");
   fem_properties.optimization_method    = prm_.get("optimization method");
   fem_properties.adjoint_type           = prm_.get_integer("adjoint type");
+  fem_properties.transposed_adjoint     = prm_.get_bool("transposed adjoint");
+  fem_properties.colored_assembly       = prm_.get_bool("colored assembly");
+  fem_properties.fluid_linear_solver    = prm_.get("fluid linear solver");
+  fem_properties.fluid_linear_tolerance = prm_.get_double("fluid linear tolerance");
+  fem_properties.ale_solver             = prm_.get("ale solver");
+  fem_properties.ale_solver_tolerance   = prm_.get_double("ale solver tolerance");
+  fem_properties.coupling_acceleration  = prm_.get("coupling acceleration");
+  fem_properties.coupling_reuse_steps   = prm_.get_integer("coupling reuse steps");
+  fem_properties.anderson_depth         = prm_.get_integer("anderson depth");
+  fem_properties.recycle_dimension      = prm_.get_integer("recycle dimension");
+  fem_properties.predictor_order        = prm_.get_integer("predictor order");
+  fem_properties.forcing_term           = prm_.get("forcing term");
+  fem_properties.forcing_gamma          = prm_.get_double("forcing gamma");
+  fem_properties.forcing_alpha          = prm_.get_double("forcing alpha");
+  fem_properties.forcing_max            = prm_.get_double("forcing max");
+  fem_properties.linearized_line_search = prm_.get_bool("linearized line search");
+  fem_properties.monolithic_linear_tolerance = prm_.get_double("monolithic linear tolerance");
   // Solver Parameters
   fem_properties.richardson		= prm_.get_bool("richardson");
   fem_properties.fluid_newton 		= prm_.get_bool("fluid newton");
   fem_properties.structure_newton 	= prm_.get_bool("structure newton");
+  fem_properties.modified_newton	= prm_.get_bool("modified newton");
+  fem_properties.jacobian_refresh_ratio	= prm_.get_double("jacobian refresh ratio");
   physical_properties.moving_domain	= prm_.get_bool("moving domain");
   physical_properties.move_domain	= prm_.get_bool("move domain");
+  physical_properties.eulerian_mapping	= prm_.get_bool("eulerian mapping");
 
   // Problem Parameters
   physical_properties.simulation_type   = prm_.get_integer("simulation type");
@@ -304,6 +464,22 @@ fluid_fe (FE_Q<dim>(prm_.get_integer("fluid velocity degree")), dim,
   physical_properties.rho_f				= prm_.get_double("fluid rho");
   physical_properties.rho_s				= prm_.get_double("structure rho");
   physical_properties.n_fourier_coeffs	= prm_.get_integer("number fourier coefficients");
+
+#ifndef FSI_UMFPACK_TRANSPOSED_SOLVE
+  AssertThrow(!fem_properties.transposed_adjoint,
+	      ExcMessage("Transposed adjoint solves need SparseDirectUMFPACK::solve with a transpose flag (deal.II 8.3 or later)."));
+#endif
+  // Without stability terms the moving domain convection of the linearized fluid operator is not
+  // the transpose of the adjoint one, so the linearized factors cannot stand in for the adjoint ones
+  AssertThrow(!(fem_properties.transposed_adjoint && physical_properties.moving_domain && !physical_properties.stability_terms),
+	      ExcMessage("Transposed adjoint solves need stability terms on a moving domain."));
+
+  coupling_accelerator.initialize(fem_properties.coupling_acceleration, fem_properties.steepest_descent_alpha,
+				  fem_properties.coupling_reuse_steps, fem_properties.anderson_depth);
+  coupling_accelerator.set_inner_product(std_cxx1x::bind(&FSIProblem<dim>::coupling_inner_product, this,
+							 std_cxx1x::_1, std_cxx1x::_2));
+  fluid_jacobian.initialize(fem_properties.jacobian_refresh_ratio);
+  structure_jacobian.initialize(fem_properties.jacobian_refresh_ratio);
 }
 
 template <int dim>
@@ -313,4 +489,62 @@ FSIProblem<dim>::~FSIProblem ()
   structure_dof_handler.clear();
 }
 
+// Runs the cell worker and copier over all active cells. Without colored assembly this is
+// WorkStream::run, which serializes the copier. With it, the cells of one color share no
+// dofs, so each color is split into chunks that are assembled and copied concurrently,
+// each task with its own copy of the scratch and per task data.
+template <int dim>
+template <class ScratchData>
+void FSIProblem<dim>::run_assembly (const DoFHandler<dim> &dof_handler,
+				    const CellColoring &colors,
+				    void (FSIProblem<dim>::*worker) (const typename DoFHandler<dim>::active_cell_iterator&, ScratchData&, PerTaskData<dim>&),
+				    void (FSIProblem<dim>::*copier) (const PerTaskData<dim>&),
+				    const ScratchData &scratch_data,
+				    const PerTaskData<dim> &per_task_data)
+{
+  if (!fem_properties.colored_assembly)
+    {
+      WorkStream::run (dof_handler.begin_active(),
+		       dof_handler.end(),
+		       *this,
+		       worker,
+		       copier,
+		       scratch_data,
+		       per_task_data);
+      return;
+    }
+
+  const unsigned int chunk_size = 32;
+  for (unsigned int c=0; c<colors.size(); ++c)
+    {
+      Threads::TaskGroup<void> tasks;
+      for (unsigned int begin=0; begin<colors[c].size(); begin+=chunk_size)
+	{
+	  const unsigned int end = std::min(begin+chunk_size, (unsigned int)colors[c].size());
+	  tasks += Threads::new_task(&FSIProblem<dim>::template assemble_colored_cells<ScratchData>, *this,
+				     colors[c], begin, end, worker, copier, scratch_data, per_task_data);
+	}
+      tasks.join_all();
+    }
+}
+
+template <int dim>
+template <class ScratchData>
+void FSIProblem<dim>::assemble_colored_cells (const std::vector<typename DoFHandler<dim>::active_cell_iterator> &cells,
+					      const unsigned int begin,
+					      const unsigned int end,
+					      void (FSIProblem<dim>::*worker) (const typename DoFHandler<dim>::active_cell_iterator&, ScratchData&, PerTaskData<dim>&),
+					      void (FSIProblem<dim>::*copier) (const PerTaskData<dim>&),
+					      const ScratchData &scratch_data,
+					      const PerTaskData<dim> &per_task_data)
+{
+  ScratchData scratch(scratch_data);
+  PerTaskData<dim> data(per_task_data);
+  for (unsigned int k=begin; k<end; ++k)
+    {
+      (this->*worker)(cells[k], scratch, data);
+      (this->*copier)(data);
+    }
+}
+
 #endif
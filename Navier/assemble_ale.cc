@@ -1,5 +1,7 @@
 #include "FSI_Project.h"
 #include "small_classes.h"
+#include <deal.II/lac/solver_control.h>
+#include <deal.II/lac/solver_cg.h>
 
 template <int dim>
 void FSIProblem<dim>::assemble_ale_matrix_on_one_cell (const typename DoFHandler<dim>::active_cell_iterator& cell,
@@ -54,7 +56,16 @@ void FSIProblem<dim>::assemble_ale (Mode enum_, bool assemble_matrix)
     }
   else if (enum_==adjoint)
     {
-      ale_matrix = &adjoint_matrix.block(2,2);
+      if (fem_properties.transposed_adjoint)
+	{
+	  // The adjoint operator is the transpose of the linearized one and is never assembled
+	  AssertThrow(!assemble_matrix, ExcMessage("The adjoint matrix is not assembled with transposed adjoint solves."));
+	  ale_matrix = &linear_matrix.block(2,2);
+	}
+      else
+	{
+	  ale_matrix = &adjoint_matrix.block(2,2);
+	}
       ale_rhs = &adjoint_rhs.block(2);
     }
   else
@@ -78,17 +89,89 @@ void FSIProblem<dim>::assemble_ale (Mode enum_, bool assemble_matrix)
   BaseScratchData<dim> scratch_data(ale_fe, quadrature_formula, update_values | update_gradients | update_quadrature_points | update_JxW_values,
 				(unsigned int)enum_);
 
-  WorkStream::run (ale_dof_handler.begin_active(),
-  		   ale_dof_handler.end(),
-  		   *this,
-  		   &FSIProblem<dim>::assemble_ale_matrix_on_one_cell,
-  		   &FSIProblem<dim>::copy_local_ale_to_global,
-		   scratch_data,
-  		   per_task_data);
+  run_assembly (ale_dof_handler,
+		ale_colors,
+		&FSIProblem<dim>::assemble_ale_matrix_on_one_cell,
+		&FSIProblem<dim>::copy_local_ale_to_global,
+		scratch_data,
+		per_task_data);
 }
 
 
 
+template <int dim>
+void FSIProblem<dim>::ale_state_solve ()
+{
+  // The ALE operator is a vector Laplacian on the reference fluid mesh, so it is
+  // assembled, constrained and factored once. Afterwards only the lifting of the
+  // current boundary values is formed: b_I = -A_IB g, b_B = diag(A_BB) g
+  std::map<types::global_dof_index,double> ale_boundary_values;
+  ale_state_boundary_values(ale_boundary_values);
+
+  if (ale_matrix_unconstrained.empty())
+    {
+      assemble_ale(state,true);
+      ale_matrix_unconstrained.reinit(sparsity_pattern.block(2,2));
+      ale_matrix_unconstrained.copy_from(system_matrix.block(2,2));
+      MatrixTools::apply_boundary_values (ale_boundary_values,
+					  system_matrix.block(2,2),
+					  solution.block(2),
+					  system_rhs.block(2));
+      if (fem_properties.ale_solver.compare("cg")==0)
+	{
+#ifdef DEAL_II_WITH_TRILINOS
+	  // The rigid translations are the near null space of the vector Laplacian
+	  TrilinosWrappers::PreconditionAMG::AdditionalData data;
+	  data.elliptic = true;
+	  data.higher_order_elements = (fem_properties.ale_degree>1);
+	  DoFTools::extract_constant_modes (ale_dof_handler, ComponentMask(dim, true), data.constant_modes);
+	  ale_preconditioner.initialize(system_matrix.block(2,2), data);
+#else
+	  ale_preconditioner.initialize(system_matrix.block(2,2), 1.2);
+#endif
+	}
+      else
+	{
+	  state_solver[2].initialize(system_matrix.block(2,2));
+	}
+    }
+
+  Vector<double> lifting(dofs_per_big_block[2]);
+  for (std::map<types::global_dof_index,double>::const_iterator it=ale_boundary_values.begin(); it!=ale_boundary_values.end(); ++it)
+    {
+      lifting(it->first) = it->second;
+    }
+  ale_matrix_unconstrained.vmult(system_rhs.block(2), lifting);
+  system_rhs.block(2) *= -1;
+  for (std::map<types::global_dof_index,double>::const_iterator it=ale_boundary_values.begin(); it!=ale_boundary_values.end(); ++it)
+    {
+      system_rhs.block(2)(it->first) = system_matrix.block(2,2).diag_element(it->first)*it->second;
+    }
+  if (fem_properties.ale_solver.compare("cg")==0)
+    {
+      // The previous mesh displacement is the initial guess
+      const double rhs_norm = system_rhs.block(2).l2_norm();
+      if (rhs_norm==0)
+	{
+	  solution.block(2) = 0;
+	}
+      else
+	{
+	  SolverControl solver_control(1000, fem_properties.ale_solver_tolerance*rhs_norm);
+	  SolverCG<Vector<double> > solver (solver_control);
+	  solver.solve(system_matrix.block(2,2), solution.block(2), system_rhs.block(2), ale_preconditioner);
+	}
+      ale_constraints.distribute (solution.block(2));
+    }
+  else
+    {
+      solve(state_solver[2],2,state);
+    }
+
+  transfer_all_dofs(solution,mesh_displacement_star,2,0);
+  mesh_displacement_star.block(2) = solution.block(2); // Euler vector of the fluid mapping
+}
+
 template void FSIProblem<2>::assemble_ale_matrix_on_one_cell (const DoFHandler<2>::active_cell_iterator &cell,
 							      BaseScratchData<2> &scratch,
 							      PerTaskData<2> &data );
@@ -96,3 +179,5 @@ template void FSIProblem<2>::assemble_ale_matrix_on_one_cell (const DoFHandler<2
 template void FSIProblem<2>::copy_local_ale_to_global (const PerTaskData<2> &data);
 
 template void FSIProblem<2>::assemble_ale (Mode enum_, bool assemble_matrix);
+
+template void FSIProblem<2>::ale_state_solve ();
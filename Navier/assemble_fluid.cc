@@ -1,4 +1,5 @@
 #include "FSI_Project.h"
+#include <deal.II/lac/compressed_simple_sparsity_pattern.h>
 #include <deal.II/base/conditional_ostream.h>
 #include <deal.II/base/std_cxx1x/condition_variable.h>
 #include <deal.II/base/std_cxx1x/condition_variable.h>
@@ -19,23 +20,37 @@ void FSIProblem<dim>::fluid_state_solve(unsigned int initialized_timestep_number
   bool newton = fem_properties.fluid_newton;
   unsigned int picard_iterations = 1;
   unsigned int loop_count = 0;
+  // Factors (or the velocity preconditioner of the block solve) are only lagged while
+  // iterating; the single pass solves need the current matrix
+  const bool lagged_jacobian = fem_properties.modified_newton
+    && physical_properties.navier_stokes && !(fem_properties.richardson && !newton);
+  fluid_jacobian.new_solve();
   do  {
     solution_star.block(0)=solution.block(0);
     //timer.enter_subsection ("Assemble");
     if (loop_count < picard_iterations) fem_properties.fluid_newton = false; 
     // Turn off Newton's method for a few picard iterations
     assemble_fluid(state, true);
-    if (loop_count < picard_iterations) fem_properties.fluid_newton = newton;
     //timer.leave_subsection();
 
     dirichlet_boundaries((System)0,state);
     //timer.enter_subsection ("State Solve"); 
-    if (timestep_number==initialized_timestep_number) {
+    if (fem_properties.fluid_linear_solver.compare("gmres")==0) {
+      const bool rebuild = !lagged_jacobian || fluid_jacobian.needs_refresh();
+      fluid_block_solve(system_matrix.block(0,0), solution.block(0), system_rhs.block(0), rebuild);
+      if (rebuild) fluid_jacobian.refreshed();
+    } else if (lagged_jacobian && !fluid_jacobian.needs_refresh()) {
+      lagged_state_solve(state_solver[0],0);
+    } else if (timestep_number==initialized_timestep_number) {
       state_solver[0].initialize(system_matrix.block(0,0));
+      solve(state_solver[0],0,state);
+      fluid_jacobian.refreshed();
     } else {
       state_solver[0].factorize(system_matrix.block(0,0));
+      solve(state_solver[0],0,state);
+      fluid_jacobian.refreshed();
     }
-    solve(state_solver[0],0,state);
+    if (loop_count < picard_iterations) fem_properties.fluid_newton = newton;
 	      
     // Pressure needs rescaled, since it was scaled/balanced against rho_f  in the operator
     // tmp = 0; tmp2 = 0;
@@ -59,6 +74,7 @@ void FSIProblem<dim>::fluid_state_solve(unsigned int initialized_timestep_number
     } else {
       std::cout << "F: " << solution_star.block(0).l2_norm() << std::endl;
     }
+    if (lagged_jacobian) fluid_jacobian.update(solution_star.block(0).l2_norm());
 	      
     loop_count++;
   } while (solution_star.block(0).l2_norm()>1e-8);
@@ -66,49 +82,49 @@ void FSIProblem<dim>::fluid_state_solve(unsigned int initialized_timestep_number
 }
 
 template <int dim>
+template <unsigned int mode_type, bool navier_stokes, bool stability_terms>
 void FSIProblem<dim>::assemble_fluid_matrix_on_one_cell (const typename DoFHandler<dim>::active_cell_iterator& cell,
-						       FullScratchData<dim>& scratch,
+						       FluidScratchData<dim>& scratch,
 						       PerTaskData<dim>& data )
 {
-  unsigned int state=0, adjoint=1;//, linear=2;
+  // mode_type, navier_stokes and stability_terms are compile time constants here, so the
+  // branches on them below are resolved when the kernel is instantiated (see fluid_cell_kernel)
 
-  ConditionalOStream pcout(std::cout,Threads::this_thread_id()==master_thread); 
   //TimerOutput timer (pcout, TimerOutput::summary,
   //		     TimerOutput::wall_times); 
   //timer.enter_subsection ("Beginning");
 
-  FluidStressValues<dim> fluid_stress_values(physical_properties);
-  FluidBoundaryValues<dim> fluid_boundary_values_function(physical_properties, fem_properties);
+  // Buffers and boundary functions are owned by the per thread scratch object
+  FluidStressValues<dim> &fluid_stress_values = scratch.fluid_stress_values;
+  FluidBoundaryValues<dim> &fluid_boundary_values_function = scratch.fluid_boundary_values_function;
   fluid_boundary_values_function.set_time (time);
 
   const FEValuesExtractors::Vector velocities (0);
   const FEValuesExtractors::Scalar pressure (dim);
 
-  std::vector<Vector<double> > old_solution_values(scratch.n_q_points, Vector<double>(dim+1));
-  std::vector<Vector<double> > old_old_solution_values(scratch.n_q_points, Vector<double>(dim+1));
-  std::vector<Vector<double> > adjoint_rhs_values(scratch.n_face_q_points, Vector<double>(dim+1));
-  std::vector<Vector<double> > linear_rhs_values(scratch.n_face_q_points, Vector<double>(dim+1));
-  std::vector<Vector<double> > u_star_values(scratch.n_q_points, Vector<double>(dim+1));
-  std::vector<Vector<double> > z(scratch.n_q_points, Vector<double>(dim+1));
-
-  std::vector<Tensor<2,dim,double> > grad_u_old (scratch.n_q_points, Tensor<2,dim,double>());
-  std::vector<Tensor<2,dim,double> > grad_u_old_old (scratch.n_q_points, Tensor<2,dim,double>());
-  std::vector<Tensor<2,dim,double> > grad_u_star (scratch.n_q_points, Tensor<2,dim,double>());
-  std::vector<Tensor<2,dim,double> > F (scratch.n_q_points, Tensor<2,dim,double>());
-  std::vector<Tensor<2,dim,double> > grad_z (scratch.n_q_points, Tensor<2,dim,double>());
-
-  std::vector<Tensor<1,dim,double> > stress_values (dim+1, Tensor<1,dim,double>());
-  Vector<double> u_true_side_values (dim+1);
-  std::vector<Vector<double> > g_stress_values(scratch.n_face_q_points, Vector<double>(dim+1));
-  std::vector<Vector<double> > old_solution_side_values(scratch.n_face_q_points, Vector<double>(dim+1));
-  std::vector<Vector<double> > old_old_solution_side_values(scratch.n_face_q_points, Vector<double>(dim+1));
-  std::vector<Vector<double> > u_star_side_values(scratch.n_face_q_points, Vector<double>(dim+1));
-
-  std::vector<Tensor<1,dim,double> > 		  phi_u (fluid_fe.dofs_per_cell, Tensor<1,dim,double>());
- 
-  std::vector<Tensor<2,dim,double> > 		  grad_phi_u (fluid_fe.dofs_per_cell, Tensor<2,dim,double>());
-  std::vector<double>                     div_phi_u   (fluid_fe.dofs_per_cell);
-  std::vector<double>                     phi_p       (fluid_fe.dofs_per_cell);
+  std::vector<Vector<double> > &old_solution_values = scratch.old_solution_values;
+  std::vector<Vector<double> > &old_old_solution_values = scratch.old_old_solution_values;
+  std::vector<Vector<double> > &adjoint_rhs_values = scratch.adjoint_rhs_values;
+  std::vector<Vector<double> > &linear_rhs_values = scratch.linear_rhs_values;
+  std::vector<Vector<double> > &u_star_values = scratch.u_star_values;
+  std::vector<Vector<double> > &z = scratch.z;
+
+  std::vector<Tensor<2,dim,double> > &grad_u_old = scratch.grad_u_old;
+  std::vector<Tensor<2,dim,double> > &grad_u_old_old = scratch.grad_u_old_old;
+  std::vector<Tensor<2,dim,double> > &grad_u_star = scratch.grad_u_star;
+  std::vector<Tensor<2,dim,double> > &F = scratch.F;
+  std::vector<Tensor<2,dim,double> > &grad_z = scratch.grad_z;
+
+  std::vector<Tensor<1,dim,double> > &stress_values = scratch.stress_values;
+  Vector<double> &u_true_side_values = scratch.u_true_side_values;
+  std::vector<Vector<double> > &g_stress_values = scratch.g_stress_values;
+  std::vector<Vector<double> > &old_solution_side_values = scratch.old_solution_side_values;
+  std::vector<Vector<double> > &old_old_solution_side_values = scratch.old_old_solution_side_values;
+  std::vector<Vector<double> > &u_star_side_values = scratch.u_star_side_values;
+
+  std::vector<Tensor<1,dim,double> > &phi_u = scratch.phi_u;
+  std::vector<Tensor<2,dim,double> > &grad_phi_u = scratch.grad_phi_u;
+  std::vector<double> &div_phi_u = scratch.div_phi_u;
 
   /*
     This is a quick test to give a sanity check for how tensor arithmetic is completed.
@@ -156,7 +172,7 @@ void FSIProblem<dim>::assemble_fluid_matrix_on_one_cell (const typename DoFHandl
 
   if (data.assemble_matrix)
     {
-      AssertThrow(!(fem_properties.richardson && !fem_properties.fluid_newton && physical_properties.navier_stokes && physical_properties.stability_terms),ExcNotImplemented());
+      AssertThrow(!(fem_properties.richardson && !fem_properties.fluid_newton && navier_stokes && stability_terms),ExcNotImplemented());
 
       scratch.fe_values.get_function_values (old_solution.block(0), old_solution_values);
       scratch.fe_values.get_function_values (solution_star.block(0),u_star_values);
@@ -197,7 +213,6 @@ void FSIProblem<dim>::assemble_fluid_matrix_on_one_cell (const typename DoFHandl
 	    {
 	      phi_u[k]	   = scratch.fe_values[velocities].value (k, q);
 	      grad_phi_u[k]    = scratch.fe_values[velocities].gradient (k, q);
-	      phi_p[k]         = scratch.fe_values[pressure].value (k, q);
 	    }
 	  for (unsigned int i=0; i<fluid_fe.dofs_per_cell; ++i)
 	    {
@@ -206,17 +221,15 @@ void FSIProblem<dim>::assemble_fluid_matrix_on_one_cell (const typename DoFHandl
 	      // 
 	      for (unsigned int j=0; j<fluid_fe.dofs_per_cell; ++j)
 		{
-		  double epsilon = 0;
-		  if (physical_properties.simulation_type==2)
-		    epsilon = 0;//1e-11; // only when all Dirichlet b.c.s
-
-		  if (physical_properties.stability_terms)
+		  // The mass, viscous and pressure terms do not depend on the iterate and
+		  // are added from fluid_stokes_matrix (see assemble_fluid_stokes_on_one_cell)
+		  if (stability_terms)
 		    {
-		      if (scratch.mode_type==state)
+		      if (mode_type==state)
 			{
-			  if (physical_properties.navier_stokes)
+			  if (navier_stokes)
 			    {
-			      // assumes not (fem_properties.richardson && !fem_properties.fluid_newton && physical_properties.stability_terms)
+			      // assumes not (fem_properties.richardson && !fem_properties.fluid_newton && stability_terms)
 			      if (fem_properties.fluid_newton)
 				{
 				  data.cell_matrix(i,j) += 0.5 * pow(fem_properties.fluid_theta,2) * physical_properties.rho_f * 
@@ -254,9 +267,9 @@ void FSIProblem<dim>::assemble_fluid_matrix_on_one_cell (const typename DoFHandl
 			  	 )* scratch.fe_values.JxW(q);
 			    }
 			}
-		      else if (scratch.mode_type==adjoint) 
+		      else if (mode_type==adjoint) 
 			{
-			  if (physical_properties.navier_stokes)
+			  if (navier_stokes)
 			    {
 			      if (fem_properties.fluid_newton)
 				{
@@ -295,9 +308,9 @@ void FSIProblem<dim>::assemble_fluid_matrix_on_one_cell (const typename DoFHandl
 			  	 )* scratch.fe_values.JxW(q);
 			    }
 			}
-		      else // scratch.mode_type==linear
+		      else // mode_type==linear
 			{
-			  if (physical_properties.navier_stokes)
+			  if (navier_stokes)
 			    {
 			      if (fem_properties.fluid_newton)
 				{
@@ -339,9 +352,9 @@ void FSIProblem<dim>::assemble_fluid_matrix_on_one_cell (const typename DoFHandl
 		    }
 		  else // stability_terms is false
 		    {
-		      if (scratch.mode_type==state)
+		      if (mode_type==state)
 			{
-			  if (physical_properties.navier_stokes)
+			  if (navier_stokes)
 			    {
 			      if (fem_properties.richardson && !fem_properties.fluid_newton)
 				{
@@ -383,9 +396,9 @@ void FSIProblem<dim>::assemble_fluid_matrix_on_one_cell (const typename DoFHandl
 			  	 )* scratch.fe_values.JxW(q);
 			    }
 			}
-		      else if (scratch.mode_type==adjoint) 
+		      else if (mode_type==adjoint) 
 			{
-			  if (physical_properties.navier_stokes)
+			  if (navier_stokes)
 			    {
 			      if (fem_properties.richardson && !fem_properties.fluid_newton)
 				{
@@ -427,9 +440,9 @@ void FSIProblem<dim>::assemble_fluid_matrix_on_one_cell (const typename DoFHandl
 			  	 )* scratch.fe_values.JxW(q);
 			    }
 			}
-		      else // scratch.mode_type==linear
+		      else // mode_type==linear
 			{
-			  if (physical_properties.navier_stokes)
+			  if (navier_stokes)
 			    {
 			      if (fem_properties.richardson && !fem_properties.fluid_newton)
 				{
@@ -476,30 +489,6 @@ void FSIProblem<dim>::assemble_fluid_matrix_on_one_cell (const typename DoFHandl
 			    }
 			}
 		    }
-
-		  if (fem_properties.time_dependent) {
-		    data.cell_matrix(i,j) +=  physical_properties.rho_f/time_step*phi_u[i]*phi_u[j] * scratch.fe_values.JxW(q);
-		  }
-		  data.cell_matrix(i,j) += ( fem_properties.fluid_theta * ( 2*physical_properties.viscosity
-							     // In the case of the Laplacian, the gradients in the scalar_product should be transposed, but
-							     // it is cheaper not to transpose both terms (and it is equivalent). 
-							       
-							     // For the symmetric tensor, it is okay to use the deformation tensor of test functions
-							     *0.25*scalar_product(grad_phi_u[j]+transpose(grad_phi_u[j]),grad_phi_u[i]+transpose(grad_phi_u[i])))
-							       
-					     // Using a nonsymmetric tensor, it can be observed that the deformation tensor of the test
-					     // functions drives the solution towards another solution
-					     //*0.5*scalar_product(transpose(grad_phi_u[j]),.5*(grad_phi_u[i]+transpose(grad_phi_u[i]))))
-					     //+ scalar_product(grad_phi_u[j],grad_phi_u[i])
-					     // Only the gradient of the test functions can be used for a nonsymmetric tensor
-					     //*0.5*scalar_product(grad_phi_u[j],grad_phi_u[i]))
-					     // same is true here about not transposing since its effect is lost (equivalent)
-					     // - physical_properties.rho_f*trace(grad_phi_u[i]) * phi_p[j] // (p,\div v)  momentum  -- Multiplier by physical_properties.rho_f is just for conditioning.
-					     // - physical_properties.rho_f*phi_p[i] * trace(grad_phi_u[j]) // (\div u, q) mass         It must be scaled back after the solve 
-					     - trace(grad_phi_u[i]) * phi_p[j] // (p,\div v)  momentum  -- Multiplier by physical_properties.rho_f is just for conditioning.
-					     - phi_p[i] * trace(grad_phi_u[j]) // (\div u, q) mass         It must be scaled back after the solve 
-					     - epsilon * phi_p[i] * phi_p[j])
-		    * scratch.fe_values.JxW(q);
 		}
 	    }
 
@@ -507,7 +496,7 @@ void FSIProblem<dim>::assemble_fluid_matrix_on_one_cell (const typename DoFHandl
 	  // LOOP TO BUILD RHS OVER DOMAIN BEGINS HERE       
 	  // 
 
-	  if (scratch.mode_type==state)
+	  if (mode_type==state)
 	    for (unsigned int i=0; i<fluid_fe.dofs_per_cell; ++i)
 	      {
 		//const double old_p = old_solution_values[q](dim);
@@ -519,11 +508,11 @@ void FSIProblem<dim>::assemble_fluid_matrix_on_one_cell (const typename DoFHandl
 		//const double div_phi_i_s =  scratch.fe_values[velocities].divergence (i, q);
 		const Tensor<2,dim,double> grad_phi_i_s = scratch.fe_values[velocities].gradient (i, q);
 		//const double div_phi_i_s =  scratch.fe_values[velocities].divergence (i, q);
-		if (physical_properties.navier_stokes)
+		if (navier_stokes)
 		  {
 		    if (fem_properties.richardson && !fem_properties.fluid_newton)
 		      {
-		        // assumes not (fem_properties.richardson && !fem_properties.fluid_newton && physical_properties.stability_terms)
+		        // assumes not (fem_properties.richardson && !fem_properties.fluid_newton && stability_terms)
 			data.cell_rhs(i) -= (1-fem_properties.fluid_theta) * physical_properties.rho_f * 
 			  (
 			   (1.5*u_old-.5*u_old_old)*transpose(grad_u_old[q])*phi_i_s
@@ -533,7 +522,7 @@ void FSIProblem<dim>::assemble_fluid_matrix_on_one_cell (const typename DoFHandl
 		      {
 			if (fem_properties.fluid_newton) 
 			  {
-			    if (physical_properties.stability_terms)
+			    if (stability_terms)
 			      {
 				data.cell_rhs(i) += 0.5 * pow(fem_properties.fluid_theta,2) * physical_properties.rho_f 
 				  * (
@@ -549,7 +538,7 @@ void FSIProblem<dim>::assemble_fluid_matrix_on_one_cell (const typename DoFHandl
 				     ) * scratch.fe_values.JxW(q);
 			      }
 			  }
-			if (physical_properties.stability_terms)
+			if (stability_terms)
 			  {
 			    data.cell_rhs(i) -= 0.5 * pow(1-fem_properties.fluid_theta,2) * physical_properties.rho_f 
 			      *( u_old*transpose(grad_u_old[q])*phi_i_s 
@@ -565,7 +554,7 @@ void FSIProblem<dim>::assemble_fluid_matrix_on_one_cell (const typename DoFHandl
 		  }
 		if (physical_properties.moving_domain) 
 		  {
-		    if (physical_properties.stability_terms)
+		    if (stability_terms)
 		      {
 			data.cell_rhs(i) -= 0.5 * (1 - fem_properties.fluid_theta) * physical_properties.rho_f 
 			  * (
@@ -614,7 +603,7 @@ void FSIProblem<dim>::assemble_fluid_matrix_on_one_cell (const typename DoFHandl
 	      scratch.fe_face_values.reinit (cell, face_no);
 
 	      if (data.assemble_matrix)
-	      if (physical_properties.navier_stokes && physical_properties.stability_terms)
+	      if (navier_stokes && stability_terms)
 	      	{
 	      	  scratch.fe_face_values.get_function_values (old_solution.block(0), old_solution_side_values);
 	      	  scratch.fe_face_values.get_function_values (solution_star.block(0), u_star_side_values);
@@ -631,7 +620,7 @@ void FSIProblem<dim>::assemble_fluid_matrix_on_one_cell (const typename DoFHandl
 	      		{
 	      		  for (unsigned int j=0; j<fluid_fe.dofs_per_cell; ++j)
 	      		    {
-	      		      if (scratch.mode_type==state)
+	      		      if (mode_type==state)
 	      			{
 				  if (fem_properties.fluid_newton)
 				    {
@@ -654,7 +643,7 @@ void FSIProblem<dim>::assemble_fluid_matrix_on_one_cell (const typename DoFHandl
 				      + (scratch.fe_face_values[velocities].value (j, q)*scratch.fe_face_values.normal_vector(q))*(u_old_side*scratch.fe_face_values[velocities].value (i, q))
 				       ) * scratch.fe_face_values.JxW(q);
 	      			}
-	      		      else if (scratch.mode_type==adjoint) 
+	      		      else if (mode_type==adjoint) 
 	      			{
 	      			  data.cell_matrix(i,j) += 0.5 * pow(fem_properties.fluid_theta,2) * physical_properties.rho_f 
 	      			    *( 
@@ -667,7 +656,7 @@ void FSIProblem<dim>::assemble_fluid_matrix_on_one_cell (const typename DoFHandl
 				      + (scratch.fe_face_values[velocities].value (i, q)*scratch.fe_face_values.normal_vector(q))*(u_old_side*scratch.fe_face_values[velocities].value (j, q))
 				       ) * scratch.fe_face_values.JxW(q);
 	      			}
-	      		      else // scratch.mode_type==linear
+	      		      else // mode_type==linear
 	      			{
 	      			  data.cell_matrix(i,j) += 0.5 * pow(fem_properties.fluid_theta,2) * physical_properties.rho_f 
 	      			    *( 
@@ -681,7 +670,7 @@ void FSIProblem<dim>::assemble_fluid_matrix_on_one_cell (const typename DoFHandl
 				       ) * scratch.fe_face_values.JxW(q);
 	      			}
 	      		    }
-			  if (scratch.mode_type==state)
+			  if (mode_type==state)
 			    {
 			      if (fem_properties.fluid_newton) 
 				{
@@ -698,7 +687,7 @@ void FSIProblem<dim>::assemble_fluid_matrix_on_one_cell (const typename DoFHandl
 	      		}
 	      	    }
 	      	}
-	      if (scratch.mode_type==state)
+	      if (mode_type==state)
 		{
 		  if (fluid_boundaries[cell->face(face_no)->boundary_indicator()]==Neumann)
 		    {
@@ -773,7 +762,7 @@ void FSIProblem<dim>::assemble_fluid_matrix_on_one_cell (const typename DoFHandl
 	      scratch.fe_face_values.reinit (cell, face_no);
 
 	      if (data.assemble_matrix)
-	      if ((!physical_properties.moving_domain && physical_properties.navier_stokes) && physical_properties.stability_terms)
+	      if ((!physical_properties.moving_domain && navier_stokes) && stability_terms)
 	      	{
 	      	  scratch.fe_face_values.get_function_values (old_solution.block(0), old_solution_side_values);
 	      	  scratch.fe_face_values.get_function_values (solution_star.block(0), u_star_side_values);
@@ -790,7 +779,7 @@ void FSIProblem<dim>::assemble_fluid_matrix_on_one_cell (const typename DoFHandl
 	      		{
 	      		  for (unsigned int j=0; j<fluid_fe.dofs_per_cell; ++j)
 	      		    {
-	      		      if (scratch.mode_type==state)
+	      		      if (mode_type==state)
 	      			{
 				  if (fem_properties.fluid_newton)
 				    {
@@ -813,7 +802,7 @@ void FSIProblem<dim>::assemble_fluid_matrix_on_one_cell (const typename DoFHandl
 				      + (scratch.fe_face_values[velocities].value (j, q)*scratch.fe_face_values.normal_vector(q))*(u_old_side*scratch.fe_face_values[velocities].value (i, q))
 				       ) * scratch.fe_face_values.JxW(q);
 	      			}
-	      		      else if (scratch.mode_type==adjoint) 
+	      		      else if (mode_type==adjoint) 
 	      			{
 	      			  data.cell_matrix(i,j) += 0.5 * pow(fem_properties.fluid_theta,2) * physical_properties.rho_f 
 	      			    *( 
@@ -826,7 +815,7 @@ void FSIProblem<dim>::assemble_fluid_matrix_on_one_cell (const typename DoFHandl
 				      + (scratch.fe_face_values[velocities].value (i, q)*scratch.fe_face_values.normal_vector(q))*(u_old_side*scratch.fe_face_values[velocities].value (j, q))
 				       ) * scratch.fe_face_values.JxW(q);
 	      			}
-	      		      else // scratch.mode_type==linear
+	      		      else // mode_type==linear
 	      			{
 	      			  data.cell_matrix(i,j) += 0.5 * pow(fem_properties.fluid_theta,2) * physical_properties.rho_f 
 	      			    *( 
@@ -840,7 +829,7 @@ void FSIProblem<dim>::assemble_fluid_matrix_on_one_cell (const typename DoFHandl
 				       ) * scratch.fe_face_values.JxW(q);
 	      			}
 	      		    }
-			  if (scratch.mode_type==state)
+			  if (mode_type==state)
 			    {
 			      if (fem_properties.fluid_newton) 
 				{
@@ -857,7 +846,7 @@ void FSIProblem<dim>::assemble_fluid_matrix_on_one_cell (const typename DoFHandl
 	      		}
 	      	    }
 	      	}
-	      if (scratch.mode_type==state)
+	      if (mode_type==state)
 		{
 		  scratch.fe_face_values.reinit (cell, face_no);
 		  scratch.fe_face_values.get_function_values (stress.block(0), g_stress_values);
@@ -886,7 +875,7 @@ void FSIProblem<dim>::assemble_fluid_matrix_on_one_cell (const typename DoFHandl
 			}
 		    }
 		}
-	      else if (scratch.mode_type==adjoint)
+	      else if (mode_type==adjoint)
 		{
 		  scratch.fe_face_values.reinit (cell, face_no);
 		  scratch.fe_face_values.get_function_values (rhs_for_adjoint.block(0), adjoint_rhs_values);
@@ -903,7 +892,7 @@ void FSIProblem<dim>::assemble_fluid_matrix_on_one_cell (const typename DoFHandl
 			}
 		    }
 		}
-	      else // scratch.mode_type==linear
+	      else // mode_type==linear
 		{
 		  scratch.fe_face_values.reinit (cell, face_no);
 		  scratch.fe_face_values.get_function_values (rhs_for_linear.block(0), linear_rhs_values);
@@ -924,9 +913,9 @@ void FSIProblem<dim>::assemble_fluid_matrix_on_one_cell (const typename DoFHandl
 	  else if (fluid_boundaries[cell->face(face_no)->boundary_indicator()]==Dirichlet)
 	    {
 	      if (data.assemble_matrix)
-	      if (physical_properties.navier_stokes && physical_properties.stability_terms)
+	      if (navier_stokes && stability_terms)
 	      	{
-		  if (scratch.mode_type==state)
+		  if (mode_type==state)
 		    {
 		      scratch.fe_face_values.reinit (cell, face_no);
 		      for (unsigned int q=0; q<scratch.n_face_q_points; ++q)
@@ -960,6 +949,174 @@ void FSIProblem<dim>::assemble_fluid_matrix_on_one_cell (const typename DoFHandl
 }
 
 
+template <int dim>
+typename FSIProblem<dim>::FluidCellKernel FSIProblem<dim>::fluid_cell_kernel (const Mode enum_) const
+{
+  // Specializations of the fluid cell kernel indexed by [mode][navier_stokes][stability_terms]
+  static const FluidCellKernel kernels[3][2][2] =
+    {
+      {{&FSIProblem<dim>::template assemble_fluid_matrix_on_one_cell<state,false,false>,
+	&FSIProblem<dim>::template assemble_fluid_matrix_on_one_cell<state,false,true>},
+       {&FSIProblem<dim>::template assemble_fluid_matrix_on_one_cell<state,true,false>,
+	&FSIProblem<dim>::template assemble_fluid_matrix_on_one_cell<state,true,true>}},
+      {{&FSIProblem<dim>::template assemble_fluid_matrix_on_one_cell<adjoint,false,false>,
+	&FSIProblem<dim>::template assemble_fluid_matrix_on_one_cell<adjoint,false,true>},
+       {&FSIProblem<dim>::template assemble_fluid_matrix_on_one_cell<adjoint,true,false>,
+	&FSIProblem<dim>::template assemble_fluid_matrix_on_one_cell<adjoint,true,true>}},
+      {{&FSIProblem<dim>::template assemble_fluid_matrix_on_one_cell<linear,false,false>,
+	&FSIProblem<dim>::template assemble_fluid_matrix_on_one_cell<linear,false,true>},
+       {&FSIProblem<dim>::template assemble_fluid_matrix_on_one_cell<linear,true,false>,
+	&FSIProblem<dim>::template assemble_fluid_matrix_on_one_cell<linear,true,true>}}
+    };
+  return kernels[enum_][physical_properties.navier_stokes][physical_properties.stability_terms];
+}
+
+template <int dim>
+void FSIProblem<dim>::assemble_fluid_stokes_on_one_cell (const typename DoFHandler<dim>::active_cell_iterator& cell,
+							 BaseScratchData<dim>& scratch,
+							 PerTaskData<dim>& data )
+{
+  const FEValuesExtractors::Vector velocities (0);
+  const FEValuesExtractors::Scalar pressure (dim);
+
+  std::vector<Tensor<1,dim,double> > phi_u (fluid_fe.dofs_per_cell, Tensor<1,dim,double>());
+  std::vector<Tensor<2,dim,double> > symgrad_phi_u (fluid_fe.dofs_per_cell, Tensor<2,dim,double>());
+  std::vector<double>                div_phi_u (fluid_fe.dofs_per_cell);
+  std::vector<double>                phi_p (fluid_fe.dofs_per_cell);
+
+  double epsilon = 0;
+  if (physical_properties.simulation_type==2)
+    epsilon = 0;//1e-11; // only when all Dirichlet b.c.s
+
+  data.cell_matrix*=0;
+  scratch.fe_values.reinit(cell);
+
+  for (unsigned int q=0; q<scratch.n_q_points; ++q)
+    {
+      for (unsigned int k=0; k<fluid_fe.dofs_per_cell; ++k)
+	{
+	  const Tensor<2,dim,double> grad_phi_u = scratch.fe_values[velocities].gradient (k, q);
+	  phi_u[k]         = scratch.fe_values[velocities].value (k, q);
+	  // For the symmetric tensor, it is okay to use the deformation tensor of test functions
+	  symgrad_phi_u[k] = 0.5*(grad_phi_u + transpose(grad_phi_u));
+	  div_phi_u[k]     = trace(grad_phi_u);
+	  phi_p[k]         = scratch.fe_values[pressure].value (k, q);
+	}
+      for (unsigned int i=0; i<fluid_fe.dofs_per_cell; ++i)
+	{
+	  for (unsigned int j=0; j<fluid_fe.dofs_per_cell; ++j)
+	    {
+	      if (fem_properties.time_dependent) {
+		data.cell_matrix(i,j) +=  physical_properties.rho_f/time_step*phi_u[i]*phi_u[j] * scratch.fe_values.JxW(q);
+	      }
+	      data.cell_matrix(i,j) += ( fem_properties.fluid_theta * 2*physical_properties.viscosity
+					 *scalar_product(symgrad_phi_u[j],symgrad_phi_u[i])
+					 - div_phi_u[i] * phi_p[j] // (p,\div v)  momentum
+					 - phi_p[i] * div_phi_u[j] // (\div u, q) mass
+					 - epsilon * phi_p[i] * phi_p[j])
+		* scratch.fe_values.JxW(q);
+	    }
+	}
+    }
+  cell->get_dof_indices (data.dof_indices);
+}
+
+template <int dim>
+void FSIProblem<dim>::copy_local_fluid_stokes_to_global (const PerTaskData<dim>& data )
+{
+  fluid_constraints.distribute_local_to_global (data.cell_matrix,
+						data.dof_indices,
+						*data.global_matrix);
+}
+
+template <int dim>
+void FSIProblem<dim>::assemble_fluid_stokes_matrix ()
+{
+  // The Stokes part only changes with the fluid geometry, i.e. never on a fixed mesh
+  // and otherwise only when the ALE displacement has moved since it was assembled
+  if (!fluid_stokes_matrix.empty())
+    {
+      if (!physical_properties.move_domain) return;
+      bool same_geometry = true;
+      for (unsigned int i=0; i<fluid_stokes_displacement.size(); ++i)
+	if (fluid_stokes_displacement[i]!=mesh_displacement_star.block(0)[i])
+	  {
+	    same_geometry = false;
+	    break;
+	  }
+      if (same_geometry) return;
+    }
+  else
+    {
+      fluid_stokes_matrix.reinit(sparsity_pattern.block(0,0));
+    }
+  fluid_stokes_matrix = 0;
+  fluid_stokes_displacement = mesh_displacement_star.block(0);
+
+  QGauss<dim>   quadrature_formula(fem_properties.fluid_degree+2);
+  PerTaskData<dim> per_task_data(fluid_fe, &fluid_stokes_matrix, 0, true);
+  BaseScratchData<dim> scratch_data(fluid_mapping(), fluid_fe, quadrature_formula, update_values | update_gradients | update_JxW_values,
+				    (unsigned int)state);
+
+  run_assembly (fluid_dof_handler,
+		fluid_colors,
+		&FSIProblem<dim>::assemble_fluid_stokes_on_one_cell,
+		&FSIProblem<dim>::copy_local_fluid_stokes_to_global,
+		scratch_data,
+		per_task_data);
+}
+
+template <int dim>
+void FSIProblem<dim>::assemble_fluid_pressure_mass_matrix ()
+{
+  // Pressure dofs follow the velocity dofs (component wise numbering), so the pressure
+  // block is the lower right corner of the fluid matrix, shifted by the velocity dofs
+  if (!fluid_pressure_mass_matrix.empty()) return;
+  const unsigned int n_u = dofs_per_block[0];
+  const unsigned int n_p = dofs_per_block[1];
+  const SparsityPattern &fluid_pattern = sparsity_pattern.block(0,0);
+
+  CompressedSimpleSparsityPattern csp (n_p, n_p);
+  for (unsigned int row=n_u; row<n_u+n_p; ++row)
+    for (SparsityPattern::iterator it=fluid_pattern.begin(row); it!=fluid_pattern.end(row); ++it)
+      if (it->column()>=n_u)
+	csp.add(row-n_u, it->column()-n_u);
+  fluid_pressure_sparsity_pattern.copy_from(csp);
+  fluid_pressure_mass_matrix.reinit(fluid_pressure_sparsity_pattern);
+
+  const FEValuesExtractors::Scalar pressure (dim);
+  QGauss<dim>   quadrature_formula(fem_properties.fluid_degree+2);
+  FEValues<dim> fe_values (fluid_fe, quadrature_formula,
+			   update_values | update_JxW_values);
+  const unsigned int dofs_per_cell = fluid_fe.dofs_per_cell;
+  std::vector<types::global_dof_index> dof_indices (dofs_per_cell);
+  std::vector<double> phi_p (dofs_per_cell);
+
+  typename DoFHandler<dim>::active_cell_iterator
+    cell = fluid_dof_handler.begin_active(),
+    endc = fluid_dof_handler.end();
+  for (; cell!=endc; ++cell)
+    {
+      fe_values.reinit(cell);
+      cell->get_dof_indices(dof_indices);
+      for (unsigned int q=0; q<quadrature_formula.size(); ++q)
+	{
+	  for (unsigned int k=0; k<dofs_per_cell; ++k)
+	    phi_p[k] = fe_values[pressure].value (k, q);
+	  for (unsigned int i=0; i<dofs_per_cell; ++i)
+	    {
+	      if (fluid_fe.system_to_component_index(i).first!=dim) continue;
+	      for (unsigned int j=0; j<dofs_per_cell; ++j)
+		{
+		  if (fluid_fe.system_to_component_index(j).first!=dim) continue;
+		  fluid_pressure_mass_matrix.add(dof_indices[i]-n_u, dof_indices[j]-n_u,
+						 phi_p[i]*phi_p[j]*fe_values.JxW(q));
+		}
+	    }
+	}
+    }
+}
+
 template <int dim>
 void FSIProblem<dim>::copy_local_fluid_to_global (const PerTaskData<dim>& data )
 {
@@ -1012,7 +1169,16 @@ void FSIProblem<dim>::assemble_fluid (Mode enum_, bool assemble_matrix)
     }
   else if (enum_==adjoint)
     {
-      fluid_matrix = &adjoint_matrix.block(0,0);
+      if (fem_properties.transposed_adjoint)
+	{
+	  // The adjoint operator is the transpose of the linearized one and is never assembled
+	  AssertThrow(!assemble_matrix, ExcMessage("The adjoint matrix is not assembled with transposed adjoint solves."));
+	  fluid_matrix = &linear_matrix.block(0,0);
+	}
+      else
+	{
+	  fluid_matrix = &adjoint_matrix.block(0,0);
+	}
       fluid_rhs = &adjoint_rhs.block(0);
     }
   else
@@ -1031,12 +1197,12 @@ void FSIProblem<dim>::assemble_fluid (Mode enum_, bool assemble_matrix)
   Vector<double> forcing_terms(fluid_rhs->size());
 
   QGauss<dim>   quadrature_formula(fem_properties.fluid_degree+2);
-  FEValues<dim> fe_values (fluid_fe, quadrature_formula,
+  FEValues<dim> fe_values (fluid_mapping(), fluid_fe, quadrature_formula,
 			   update_values    | update_gradients  |
 			   update_quadrature_points | update_JxW_values);
 
   QGauss<dim-1> face_quadrature_formula(fem_properties.fluid_degree+2);
-  FEFaceValues<dim> fe_face_values (fluid_fe, face_quadrature_formula,
+  FEFaceValues<dim> fe_face_values (fluid_mapping(), fluid_fe, face_quadrature_formula,
 				    update_values    | update_normal_vectors |
 				    update_quadrature_points  | update_JxW_values);
 
@@ -1061,13 +1227,14 @@ void FSIProblem<dim>::assemble_fluid (Mode enum_, bool assemble_matrix)
     }
 
   ale_transform_fluid(); // Move the domain to the deformed ALE configuration
+  if (assemble_matrix) assemble_fluid_stokes_matrix();
 
   //static int master_thread = Threads::this_thread_id();
 
   PerTaskData<dim> per_task_data(fluid_fe, fluid_matrix, fluid_rhs, assemble_matrix);
-  FullScratchData<dim> scratch_data(fluid_fe, quadrature_formula, update_values | update_gradients | update_quadrature_points | update_JxW_values,
-				     face_quadrature_formula, update_values | update_normal_vectors | update_quadrature_points  | update_JxW_values,
-				     (unsigned int)enum_);//, vertices_quadrature_formula, update_values);
+  FluidScratchData<dim> scratch_data(fluid_mapping(), fluid_fe, quadrature_formula, update_values | update_gradients | update_quadrature_points | update_JxW_values,
+				      face_quadrature_formula, update_values | update_normal_vectors | update_quadrature_points  | update_JxW_values,
+				      (unsigned int)enum_, physical_properties, fem_properties);
  
   // WorkStream::run (fluid_dof_handler.begin_active(),
   // 		   fluid_dof_handler.end(),
@@ -1084,13 +1251,12 @@ void FSIProblem<dim>::assemble_fluid (Mode enum_, bool assemble_matrix)
   // 		   per_task_data);
 
 
-  WorkStream::run (fluid_dof_handler.begin_active(),
-  		   fluid_dof_handler.end(),
-  		   *this,
-  		   &FSIProblem<dim>::assemble_fluid_matrix_on_one_cell,
-  		   &FSIProblem<dim>::copy_local_fluid_to_global,
-  		   scratch_data,
-  		   per_task_data);
+  run_assembly (fluid_dof_handler,
+		fluid_colors,
+		fluid_cell_kernel(enum_),
+		&FSIProblem<dim>::copy_local_fluid_to_global,
+		scratch_data,
+		per_task_data);
 
   // // TEMPORARY VISUALIZATION OF MOVED VERTICES
   // const std::string fluid_mesh_filename = "fluid-mesh" +
@@ -1101,73 +1267,56 @@ void FSIProblem<dim>::assemble_fluid (Mode enum_, bool assemble_matrix)
   // grid_out.write_eps (fluid_triangulation, mesh_out);
   // // 
 
+  if (assemble_matrix) fluid_matrix->add(1.0, fluid_stokes_matrix);
+
   ref_transform_fluid(); // Move the domain back to reference configuration
 }
 
 template <int dim>
 void FSIProblem<dim>::ale_transform_fluid()
 {
-  QTrapez<dim> vertices_quadrature_formula;
-  FEValues<dim> fe_vertices_values (fluid_fe, vertices_quadrature_formula,
-				    update_values);
-  std::vector<Vector<double> > z_vertices(vertices_quadrature_formula.size(), Vector<double>(dim+1));
-  std::vector<Vector<double> > z_old_vertices(vertices_quadrature_formula.size(), Vector<double>(dim+1));
-  std::set<unsigned int> visited_vertices;
-  typename DoFHandler<dim>::active_cell_iterator
-    cell = fluid_dof_handler.begin_active(),
-    endc = fluid_dof_handler.end();
-  for (; cell!=endc; ++cell) {
-    fe_vertices_values.reinit(cell);
-    if (physical_properties.move_domain)
-      {
-	for (unsigned int i=0; i<GeometryInfo<dim>::vertices_per_cell; ++i)
-	  {
-	    if (visited_vertices.find(cell->vertex_index(i)) == visited_vertices.end())
-	      {
-		Point<2> &v = cell->vertex(i);
-		fe_vertices_values.get_function_values(mesh_displacement_star.block(0), z_vertices);
-		fe_vertices_values.get_function_values(mesh_displacement_star_old.block(0), z_old_vertices);
-		for (unsigned int j=0; j<dim; ++j)
-		  {
-		    v(j) += z_vertices[i](j);
-		  }
-		visited_vertices.insert(cell->vertex_index(i));
-	      }
-	  }
-      }
-  }
+  displace_fluid_vertices(1.0);
 }
 
 template <int dim>
 void FSIProblem<dim>::ref_transform_fluid()
 {
+  displace_fluid_vertices(-1.0);
+}
+
+template <int dim>
+void FSIProblem<dim>::displace_fluid_vertices(const double direction)
+{
+  // With the Eulerian mapping the deformed domain is only seen through fluid_mapping()
+  if (!physical_properties.move_domain || physical_properties.eulerian_mapping) return;
+
   QTrapez<dim> vertices_quadrature_formula;
   FEValues<dim> fe_vertices_values (fluid_fe, vertices_quadrature_formula,
 				    update_values);
   std::vector<Vector<double> > z_vertices(vertices_quadrature_formula.size(), Vector<double>(dim+1));
-  std::vector<Vector<double> > z_old_vertices(vertices_quadrature_formula.size(), Vector<double>(dim+1));
-  std::set<unsigned int> visited_vertices;
+  std::vector<bool> visited_vertices(fluid_triangulation.n_vertices(), false);
   typename DoFHandler<dim>::active_cell_iterator
     cell = fluid_dof_handler.begin_active(),
     endc = fluid_dof_handler.end();
   for (; cell!=endc; ++cell) {
+    bool new_vertex = false;
+    for (unsigned int i=0; i<GeometryInfo<dim>::vertices_per_cell; ++i)
+      if (!visited_vertices[cell->vertex_index(i)]) new_vertex = true;
+    if (!new_vertex) continue;
+
     fe_vertices_values.reinit(cell);
-    if (physical_properties.move_domain)
+    fe_vertices_values.get_function_values(mesh_displacement_star.block(0), z_vertices);
+    for (unsigned int i=0; i<GeometryInfo<dim>::vertices_per_cell; ++i)
       {
-  	for (unsigned int i=0; i<GeometryInfo<dim>::vertices_per_cell; ++i)
-  	  {
-  	    if (visited_vertices.find(cell->vertex_index(i)) == visited_vertices.end())
-  	      {
-  		Point<2> &v = cell->vertex(i);
-  		fe_vertices_values.get_function_values(mesh_displacement_star.block(0), z_vertices);
-  		fe_vertices_values.get_function_values(mesh_displacement_star_old.block(0), z_old_vertices);
-  		for (unsigned int j=0; j<dim; ++j)
-  		  {
-  		    v(j) -= z_vertices[i](j);
-  		  }
-  		visited_vertices.insert(cell->vertex_index(i));
-  	      }
-  	  }
+	if (!visited_vertices[cell->vertex_index(i)])
+	  {
+	    Point<dim> &v = cell->vertex(i);
+	    for (unsigned int j=0; j<dim; ++j)
+	      {
+		v(j) += direction*z_vertices[i](j);
+	      }
+	    visited_vertices[cell->vertex_index(i)] = true;
+	  }
       }
   }
 }
@@ -1176,18 +1325,28 @@ void FSIProblem<dim>::ref_transform_fluid()
 
 template void FSIProblem<2>::fluid_state_solve(unsigned int initialized_timestep_number);
 
-template void FSIProblem<2>::assemble_fluid_matrix_on_one_cell (const DoFHandler<2>::active_cell_iterator& cell,
-							     FullScratchData<2>& scratch,
-							     PerTaskData<2>& data );
+template FSIProblem<2>::FluidCellKernel FSIProblem<2>::fluid_cell_kernel (const Mode enum_) const;
+
+template void FSIProblem<2>::assemble_fluid_pressure_mass_matrix ();
 
 template void FSIProblem<2>::copy_local_fluid_to_global (const PerTaskData<2> &data);
 
+template void FSIProblem<2>::assemble_fluid_stokes_on_one_cell (const DoFHandler<2>::active_cell_iterator& cell,
+								BaseScratchData<2>& scratch,
+								PerTaskData<2>& data );
+
+template void FSIProblem<2>::copy_local_fluid_stokes_to_global (const PerTaskData<2> &data);
+
+template void FSIProblem<2>::assemble_fluid_stokes_matrix ();
+
 template void FSIProblem<2>::assemble_fluid (Mode enum_, bool assemble_matrix);
 
 template void FSIProblem<2>::ale_transform_fluid();
 
 template void FSIProblem<2>::ref_transform_fluid();
 
+template void FSIProblem<2>::displace_fluid_vertices(const double direction);
+
 
 // h           fluid.vel.L2   fluid.vel.H1   fluid.press.L2   structure.displ.L2   structure.displ.H1   structure.vel.L2
 // 0.353553               -              -                -                    -                    -                  -
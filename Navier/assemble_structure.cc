@@ -8,9 +8,9 @@ void FSIProblem<dim>::structure_state_solve(unsigned int initialized_timestep_nu
   // pcout <<"Before structure"<<std::endl;
   // solution_star.block(1)=1;
   // solution_star.block(1) = solution.block(1); 
-  if (fem_properties.optimization_method.compare("DN")==0) {
-    tmp.block(1) = solution.block(1);
-  }
+  // Factors are only lagged while iterating; linear elasticity is solved in one pass
+  const bool lagged_jacobian = fem_properties.modified_newton && physical_properties.nonlinear_elasticity;
+  structure_jacobian.new_solve();
   do {
     solution_star.block(1)=solution.block(1);
     //timer.enter_subsection ("Assemble");
@@ -22,72 +22,75 @@ void FSIProblem<dim>::structure_state_solve(unsigned int initialized_timestep_nu
     //timer.leave_subsection();
     dirichlet_boundaries((System)1,state);
     //timer.enter_subsection ("State Solve"); 
-    if (timestep_number==initialized_timestep_number)
+    if (lagged_jacobian && !structure_jacobian.needs_refresh())
       {
-	state_solver[1].initialize(system_matrix.block(1,1));
+	lagged_state_solve(state_solver[1],1);
       }
-    else 
+    else
       {
-	state_solver[1].factorize(system_matrix.block(1,1));
+	if (timestep_number==initialized_timestep_number)
+	  {
+	    state_solver[1].initialize(system_matrix.block(1,1));
+	  }
+	else 
+	  {
+	    state_solver[1].factorize(system_matrix.block(1,1));
+	  }
+	solve(state_solver[1],1,state);
+	structure_jacobian.refreshed();
       }
-    solve(state_solver[1],1,state);
     //timer.leave_subsection ();
     solution_star.block(1)-=solution.block(1);
     //++total_solves;
     std::cout << "S: " << solution_star.block(1).l2_norm() << std::endl;
+    if (lagged_jacobian) structure_jacobian.update(solution_star.block(1).l2_norm());
   } while (solution_star.block(1).l2_norm()>1e-8 && physical_properties.nonlinear_elasticity);
   solution_star.block(1) = solution.block(1); 
-  if (fem_properties.optimization_method.compare("DN")==0) {
-    tmp.block(1) *= (1-fem_properties.steepest_descent_alpha);
-    tmp.block(1).add(fem_properties.steepest_descent_alpha, solution.block(1));
-    solution.block(1) = tmp.block(1);
-    solution_star.block(1) = solution.block(1);
-  }
  
   
 }
 
 
 template <int dim>
+template <unsigned int mode_type, bool nonlinear_elasticity, bool structure_newton>
 void FSIProblem<dim>::assemble_structure_matrix_on_one_cell (const typename DoFHandler<dim>::active_cell_iterator& cell,
-						       FullScratchData<dim>& scratch,
+						       StructureScratchData<dim>& scratch,
 						       PerTaskData<dim>& data )
 {
-  unsigned int state=0, adjoint=1, linear=2;
+  // mode_type, nonlinear_elasticity and structure_newton are compile time constants here
+  // (see structure_cell_kernel), so the loops below carry no branches on them
 
-  ConditionalOStream pcout(std::cout,Threads::this_thread_id()==master_thread); 
   //TimerOutput timer (pcout, TimerOutput::summary,
   //		     TimerOutput::wall_times); 
   //timer.enter_subsection ("Beginning");
 
-  StructureRightHandSide<dim> rhs_function(physical_properties);
+  StructureRightHandSide<dim> &rhs_function = scratch.rhs_function;
 
-  StructureStressValues<dim> structure_stress_values(physical_properties);
+  StructureStressValues<dim> &structure_stress_values = scratch.structure_stress_values;
   structure_stress_values.set_time(time);
-  StructureStressValues<dim> old_structure_stress_values(physical_properties);
+  StructureStressValues<dim> &old_structure_stress_values = scratch.old_structure_stress_values;
   old_structure_stress_values.set_time(time-time_step);
 
   const FEValuesExtractors::Vector displacements (0);
   const FEValuesExtractors::Vector velocities (dim);
 
-  std::vector<Vector<double> > old_solution_values(scratch.n_q_points, Vector<double>(2*dim));
-  //std::vector<Vector<double> > adjoint_rhs_values(scratch.n_face_q_points, Vector<double>(2*dim));
-  //std::vector<Vector<double> > linear_rhs_values(scratch.n_face_q_points, Vector<double>(2*dim));
-  std::vector<Tensor<2,dim,double>  > grad_n_star (scratch.n_q_points, Tensor<2,dim,double>());
-  std::vector<Tensor<2,dim,double>  > grad_n_old (scratch.n_q_points, Tensor<2,dim,double>());
-  //std::vector<Vector<double> > g_stress_values(scratch.n_face_q_points, Vector<double>(2*dim));
-  std::vector<Tensor<1,dim,double>  > stress_values (2*dim, Tensor<1,dim,double>());
+  std::vector<Tensor<1,dim,double>  > &stress_values = scratch.stress_values;
   Tensor<1,dim,double> old_rhs_values;
   Tensor<1,dim,double> rhs_values;
 
-  std::vector<Tensor<1,dim,double> > 		phi_n (structure_fe.dofs_per_cell, Tensor<1,dim,double>());
-  std::vector<Tensor<1,dim,double> >           phi_v       (structure_fe.dofs_per_cell, Tensor<1,dim,double>());
-  std::vector<Tensor<2,dim,double> > 	        grad_phi_n (structure_fe.dofs_per_cell, Tensor<2,dim,double>());
-  std::vector<Tensor<2,dim,double> > 	        F (structure_fe.dofs_per_cell, Tensor<2,dim,double>());
-  std::vector<Tensor<2,dim,double> > 	        E (structure_fe.dofs_per_cell, Tensor<2,dim,double>());
-  std::vector<Tensor<2,dim,double> > 	        S (structure_fe.dofs_per_cell, Tensor<2,dim,double>());
-  std::vector<Tensor<2,dim,double> > 	        E2 (structure_fe.dofs_per_cell, Tensor<2,dim,double>());
-  std::vector<Tensor<2,dim,double> > 	        S2 (structure_fe.dofs_per_cell, Tensor<2,dim,double>());
+  // Per dof tables of the current quadrature point, owned by the scratch object
+  std::vector<Tensor<1,dim,double> > &phi_n = scratch.phi_n;
+  std::vector<Tensor<1,dim,double> > &phi_v = scratch.phi_v;
+  std::vector<Tensor<2,dim,double> > &grad_phi_n = scratch.grad_phi_n;
+  std::vector<Tensor<2,dim,double> > &symgrad_phi_n = scratch.symgrad_phi_n;
+  std::vector<Tensor<2,dim,double> > &S = scratch.S;
+  std::vector<Tensor<2,dim,double> > &S2 = scratch.S2;
+  std::vector<Vector<double> > &old_solution_values = scratch.old_solution_values;
+  std::vector<Tensor<2,dim,double> > &grad_n_star = scratch.grad_n_star;
+  std::vector<Tensor<2,dim,double> > &grad_n_old = scratch.grad_n_old;
+  const std::vector<unsigned int> &displacement_dofs = scratch.displacement_dofs;
+  const std::vector<unsigned int> &velocity_dofs = scratch.velocity_dofs;
+  const std::vector<unsigned int> &component = scratch.component;
 
   scratch.fe_values.reinit(cell);
   data.cell_matrix*=0;
@@ -97,6 +100,10 @@ void FSIProblem<dim>::assemble_structure_matrix_on_one_cell (const typename DoFH
   for (unsigned int i=0; i<dim; ++i)
     Identity[i][i]=1.0;
 
+  const double theta = fem_properties.structure_theta;
+  // The adjoint cell matrix is the linearized one with the roles of i and j swapped
+  const bool transposed = (mode_type==adjoint);
+
   //timer.leave_subsection ();
   //timer.enter_subsection ("Assembly");
   if (data.assemble_matrix)
@@ -113,6 +120,7 @@ void FSIProblem<dim>::assemble_structure_matrix_on_one_cell (const typename DoFH
       for (unsigned int q=0; q<scratch.n_q_points;
 	   ++q)
 	{ 
+	  const double JxW = scratch.fe_values.JxW(q);
 	  for (unsigned int k=0; k<dim; ++k) {
 	    rhs_function.set_time(time);
 	    rhs_values[k] = rhs_function.value(scratch.fe_values.quadrature_point(q), k);
@@ -130,252 +138,167 @@ void FSIProblem<dim>::assemble_structure_matrix_on_one_cell (const typename DoFH
 
 	  Tensor<2,dim,double> F_old = Identity + grad_n_old[q];
 	  Tensor<2,dim,double> E_old;
-	  if (!physical_properties.nonlinear_elasticity) {
+	  if (!nonlinear_elasticity) {
 	    E_old = .5 * (transpose(F_old)*F_old - Identity - transpose(grad_n_old[q])*grad_n_old[q]);
 	    F_old = Identity;
+	    F_star = Identity;
 	  } else {
 	    E_old = .5 * (transpose(F_old)*F_old - Identity);
 	  }
 	  Tensor<2,dim,double> S_old = physical_properties.lambda*trace(E_old)*Identity + 2*physical_properties.mu*E_old;
 	  double det_F_old = determinant(F_old);
-	  
-	  for (unsigned int k=0; k<structure_fe.dofs_per_cell; ++k)
+	  const Tensor<2,dim,double> transpose_F_star = transpose(F_star);
+
+	  // Displacement shape functions carry no velocity part and vice versa,
+	  // so each table is only filled on its own dofs
+	  for (unsigned int a=0; a<displacement_dofs.size(); ++a)
 	    {
+	      const unsigned int k = displacement_dofs[a];
 	      phi_n[k]	       = scratch.fe_values[displacements].value (k, q);
 	      grad_phi_n[k]    = scratch.fe_values[displacements].gradient (k, q);
-	      phi_v[k]         = scratch.fe_values[velocities].value (k, q);
-	      F[k]             = Identity + grad_phi_n[k];
-	      if (!physical_properties.nonlinear_elasticity) {
-		E[k]             = .5 * (transpose(F[k])*F[k] - Identity - transpose(grad_phi_n[k])*grad_phi_n[k]); // definition of linear stress
-		F_star = Identity;
+	      // .5 * (transpose(F)*F - Identity - transpose(grad_phi_n)*grad_phi_n) with F = Identity + grad_phi_n
+	      symgrad_phi_n[k] = .5 * (grad_phi_n[k] + transpose(grad_phi_n[k])); // definition of linear stress
+	      Tensor<2,dim,double> E = symgrad_phi_n[k];
+	      if (nonlinear_elasticity) {
+		E += .5 * transpose(grad_n_star[q])*grad_phi_n[k];
+	      }
+	      S[k] = physical_properties.lambda*trace(E)*Identity + 2*physical_properties.mu*E;
+	      if (nonlinear_elasticity && structure_newton) {
+		const Tensor<2,dim,double> E2 = E + .5 * transpose(grad_phi_n[k])*grad_n_star[q]; // add nonlinear contribution back in
+		S2[k] = (physical_properties.lambda*trace(E2)*Identity + 2*physical_properties.mu*E2)*transpose_F_star;
 	      } else {
-		E[k]             = .5 * (transpose(F[k])*F[k] - Identity - transpose(grad_phi_n[k])*grad_phi_n[k]); // remove nonlinear contribution
-		E[k]            +=  .5 * transpose(grad_n_star[q])*grad_phi_n[k];
-		if (fem_properties.structure_newton) {
-		  E2[k]          = E[k] + .5 * transpose(grad_phi_n[k])*grad_n_star[q]; // add nonlinear contribution back in
-		} 
+		S2[k] = 0;
 	      }
-	      S[k]             = physical_properties.lambda*trace(E[k])*Identity + 2*physical_properties.mu*E[k];
-	      S2[k]            = physical_properties.lambda*trace(E2[k])*Identity + 2*physical_properties.mu*E2[k];
+	    }
+	  for (unsigned int a=0; a<velocity_dofs.size(); ++a)
+	    {
+	      const unsigned int k = velocity_dofs[a];
+	      phi_v[k]         = scratch.fe_values[velocities].value (k, q);
 	    }
 
-	  for (unsigned int i=0; i<structure_fe.dofs_per_cell; ++i)
+	  // displacement rows, displacement columns
+	  for (unsigned int a=0; a<displacement_dofs.size(); ++a)
 	    {
-	      const unsigned int
-		component_i = structure_fe.system_to_component_index(i).first;
-	      for (unsigned int j=0; j<structure_fe.dofs_per_cell; ++j)
+	      const unsigned int i = displacement_dofs[a];
+	      for (unsigned int b=0; b<displacement_dofs.size(); ++b)
 		{
-		  const unsigned int
-		    component_j = structure_fe.system_to_component_index(j).first;
+		  const unsigned int j = displacement_dofs[b];
+		  const unsigned int row = transposed ? j : i;
+		  const unsigned int col = transposed ? i : j;
+		  if (nonlinear_elasticity) {
+		    // Formulation 1: (worst)
+		    // scalar_product(.5*F_star*S[j], grad_phi_n[i])
+		    // or
+		    // Formulation 2: (medium)
+		    // scalar_product(.5*grad_phi_n[j]*S_star, grad_phi_n[i])
+		    // or
+		    // Formulation 3: (best)
+		    const Tensor<2,dim,double> transpose_grad_phi_row = transpose(grad_phi_n[row]);
+		    double value = scalar_product(S_star*transpose(grad_phi_n[col]), transpose_grad_phi_row);
+		    if (mode_type==state && !structure_newton) {
+		      value += scalar_product(S[col], transpose_grad_phi_row);
+		    } else {
+		      value += scalar_product(S2[col], transpose_grad_phi_row);
+		    }
+		    data.cell_matrix(i,j) += theta * value * JxW;
+		  } else {
+		    data.cell_matrix(i,j) += theta * scalar_product(S[col], symgrad_phi_n[row]) * JxW;
+		  }
+		}
+	    }
 
-		  if ((scratch.mode_type)==state)
-		    {
+	  // velocity rows, velocity columns: only matching components couple
+	  for (unsigned int a=0; a<velocity_dofs.size(); ++a)
+	    {
+	      const unsigned int i = velocity_dofs[a];
+	      for (unsigned int b=0; b<velocity_dofs.size(); ++b)
+		{
+		  const unsigned int j = velocity_dofs[b];
+		  if (component[i]!=component[j]) continue;
+		  if (fem_properties.time_dependent) {
+		    data.cell_matrix(i,j)+=(theta*phi_v[i]*phi_v[j])*JxW;
+		  } else {
+		    data.cell_matrix(i,j)+=phi_v[i]*phi_v[j]*JxW;
+		  }
+		}
+	    }
 
-		      if (component_i<dim)
-			{
-			  if (component_j<dim)
-			    {
-			      if (physical_properties.nonlinear_elasticity) {
-				if (fem_properties.structure_newton) {
-				  data.cell_matrix(i,j)+= (
-							   scalar_product(fem_properties.structure_theta*S_star*transpose(grad_phi_n[j]), transpose(grad_phi_n[i]))
-							   + scalar_product(fem_properties.structure_theta*S2[j]*transpose(F_star), transpose(grad_phi_n[i]))
-							   )*scratch.fe_values.JxW(q);
-				} else {
-				  data.cell_matrix(i,j)+= (
-							   // Formulation 1: (worst)
-							   // scalar_product(.5*F_star*S[j], grad_phi_n[i])
-							   // or
-							   // Formulation 2: (medium)
-							   // scalar_product(.5*grad_phi_n[j]*S_star, grad_phi_n[i])
-							   // or
-							   // Formulation 3: (best)
-							   scalar_product(fem_properties.structure_theta*S_star*transpose(grad_phi_n[j]), transpose(grad_phi_n[i]))
-							   + scalar_product(fem_properties.structure_theta*S[j], transpose(grad_phi_n[i]))
-							   )*scratch.fe_values.JxW(q);
-				}
-			      } else {
-				data.cell_matrix(i,j)+= fem_properties.structure_theta * scalar_product(S[j], .5*(grad_phi_n[i] + transpose(grad_phi_n[i])))
-				  *scratch.fe_values.JxW(q);
-			      }
-			    }
-			  else
-			    {
-			      if (fem_properties.time_dependent) {
-				data.cell_matrix(i,j)+=physical_properties.rho_s/time_step*phi_n[i]*phi_v[j]*scratch.fe_values.JxW(q);
-			      }
-			    }
-			}
-		      else
-			{
-			  if (component_j<dim)
-			    {
-			      if (fem_properties.time_dependent) {
-				data.cell_matrix(i,j)+=(-1./time_step*phi_v[i]*phi_n[j])
-				  *scratch.fe_values.JxW(q);
-			      }
-			    }
-			  else
-			    {
-			      if (fem_properties.time_dependent) {
-				data.cell_matrix(i,j)+=(fem_properties.structure_theta*phi_v[i]*phi_v[j])
-				  *scratch.fe_values.JxW(q);
-			      } else {
-				data.cell_matrix(i,j)+=phi_v[i]*phi_v[j]*scratch.fe_values.JxW(q);
-			      }
-			    }
-			}
-		    }
-		  else if ((scratch.mode_type)==linear) 
+	  // displacement/velocity coupling blocks, again only between matching components
+	  if (fem_properties.time_dependent)
+	    {
+	      const double displacement_row_factor = transposed ? -1./time_step : physical_properties.rho_s/time_step;
+	      const double velocity_row_factor = transposed ? physical_properties.rho_s/time_step : -1./time_step;
+	      for (unsigned int a=0; a<displacement_dofs.size(); ++a)
+		{
+		  const unsigned int n = displacement_dofs[a];
+		  for (unsigned int b=0; b<velocity_dofs.size(); ++b)
 		    {
-		      if (component_i<dim)
-			{
-			  if (component_j<dim)
-			    {
-			      if (physical_properties.nonlinear_elasticity) {
-				data.cell_matrix(i,j)+= (
-							 scalar_product(fem_properties.structure_theta*S_star*transpose(grad_phi_n[j]), transpose(grad_phi_n[i]))
-							 + scalar_product(fem_properties.structure_theta*S2[j]*transpose(F_star), transpose(grad_phi_n[i]))
-							 )*scratch.fe_values.JxW(q);
-			      } else {
-				data.cell_matrix(i,j)+= fem_properties.structure_theta * scalar_product(S[j], .5*(grad_phi_n[i] + transpose(grad_phi_n[i])))
-				  *scratch.fe_values.JxW(q);
-			      }
-			    }
-			  else
-			    {
-			      if (fem_properties.time_dependent) {
-				data.cell_matrix(i,j)+=physical_properties.rho_s/time_step*phi_n[i]*phi_v[j]*scratch.fe_values.JxW(q);
-			      }
-			    }
-			}
-		      else
-			{
-			  if (component_j<dim)
-			    {
-			      if (fem_properties.time_dependent) {
-				data.cell_matrix(i,j)+=(-1./time_step*phi_v[i]*phi_n[j])
-				  *scratch.fe_values.JxW(q);
-			      }
-			    }
-			  else
-			    {
-			      if (fem_properties.time_dependent) {
-				data.cell_matrix(i,j)+=(fem_properties.structure_theta*phi_v[i]*phi_v[j])
-				  *scratch.fe_values.JxW(q);
-			      } else {
-				data.cell_matrix(i,j)+=phi_v[i]*phi_v[j]*scratch.fe_values.JxW(q);
-			      }
-			    }
-			}
-		    }
-		  else 
-		    { // scratch.mode_type==adjoint
-		      if (component_i<dim)
-			{
-			  if (component_j<dim)
-			    {
-			      if (physical_properties.nonlinear_elasticity) {
-				data.cell_matrix(i,j)+= (
-							 scalar_product(fem_properties.structure_theta*S_star*transpose(grad_phi_n[i]), transpose(grad_phi_n[j]))
-							 + scalar_product(fem_properties.structure_theta*S2[i]*transpose(F_star), transpose(grad_phi_n[j]))
-							 )*scratch.fe_values.JxW(q);
-			      } else {
-				data.cell_matrix(i,j)+= fem_properties.structure_theta * scalar_product(S[i], .5*(grad_phi_n[j] + transpose(grad_phi_n[j])))
-				  *scratch.fe_values.JxW(q);
-			      }
-			    }
-			  else
-			    {
-			      if (fem_properties.time_dependent) {
-				data.cell_matrix(i,j)+=-1./time_step*phi_n[i]*phi_v[j]*scratch.fe_values.JxW(q);
-			      }
-			    }
-			}
-		      else
-			{
-			  if (component_j<dim)
-			    {
-			      if (fem_properties.time_dependent) {
-				data.cell_matrix(i,j)+=physical_properties.rho_s/time_step*phi_v[i]*phi_n[j]*scratch.fe_values.JxW(q);
-			      }
-			    }
-			  else
-			    {
-			      if (fem_properties.time_dependent) {
-				data.cell_matrix(i,j)+=(fem_properties.structure_theta*phi_v[i]*phi_v[j])
-				  *scratch.fe_values.JxW(q);
-			      } else {
-				data.cell_matrix(i,j)+=phi_v[i]*phi_v[j]*scratch.fe_values.JxW(q);
-			      }
-			    }
-			}
+		      const unsigned int v = velocity_dofs[b];
+		      if (component[v]!=component[n]+dim) continue;
+		      const double mass = phi_n[n]*phi_v[v]*JxW;
+		      data.cell_matrix(n,v) += displacement_row_factor*mass;
+		      data.cell_matrix(v,n) += velocity_row_factor*mass;
 		    }
 		}
 	    }
 	  
-	  if ((scratch.mode_type)==state)
+	  if (mode_type==state)
 	    {
 	      //timer.enter_subsection ("Rhs Assembly");
-	      for (unsigned int i=0; i<structure_fe.dofs_per_cell; ++i)
+	      Tensor<1,dim,double> old_n;
+	      Tensor<1,dim,double> old_v;
+	      for (unsigned int d=0; d<dim; ++d)
+		old_n[d] = old_solution_values[q](d);
+	      for (unsigned int d=0; d<dim; ++d)
+		old_v[d] = old_solution_values[q](d+dim);
+	      for (unsigned int a=0; a<displacement_dofs.size(); ++a)
 		{
-		  const unsigned int component_i = structure_fe.system_to_component_index(i).first;
-		  Tensor<1,dim,double> old_n;
-		  Tensor<1,dim,double> old_v;
-		  for (unsigned int d=0; d<dim; ++d)
-		    old_n[d] = old_solution_values[q](d);
-		  for (unsigned int d=0; d<dim; ++d)
-		    old_v[d] = old_solution_values[q](d+dim);
-		  const Tensor<1,dim,double> phi_i_eta      	= scratch.fe_values[displacements].value (i, q);
-		  // const Tensor<2,dim> symgrad_phi_i_eta 	= scratch.fe_values[displacements].symmetric_gradient (i, q);
-		  const Tensor<2,dim,double> grad_phi_i_eta 	= scratch.fe_values[displacements].gradient (i, q);
-		  // const double div_phi_i_eta 			= scratch.fe_values[displacements].divergence (i, q);
-		  const Tensor<1,dim,double> phi_i_eta_dot  	= scratch.fe_values[velocities].value (i, q);
-		  
-		  if (component_i<dim)
-		    {
-		      if (physical_properties.simulation_type==0 || physical_properties.simulation_type==2) {
-		      	data.cell_rhs(i) += ((1-fem_properties.structure_theta)*old_rhs_values + fem_properties.structure_theta*rhs_values) *phi_i_eta* scratch.fe_values.JxW(q);
-		      } else {
-			data.cell_rhs(i) += ((1-fem_properties.structure_theta)*det_F_old*old_rhs_values + fem_properties.structure_theta*det_F_star*rhs_values) *phi_i_eta* scratch.fe_values.JxW(q);
-		      	// data.cell_rhs(i) += ((1-fem_properties.structure_theta)*old_rhs_values + fem_properties.structure_theta*rhs_values) *phi_i_eta* scratch.fe_values.JxW(q);
-		      }
-		      if (physical_properties.nonlinear_elasticity) {
-			if (fem_properties.time_dependent) {
-			  data.cell_rhs(i) += (physical_properties.rho_s/time_step *phi_i_eta*old_v
-					     // Formulation 1: 
-					     // - scalar_product(.5*F_old*S_old, grad_phi_i_eta)
-					     // or
-					     // Formulation 2:
-					     // - scalar_product(.5*F_old*S_old, grad_phi_i_eta)
-					     // - scalar_product(.5*S_star, grad_phi_i_eta)
-					     // or
-					     // Formulation 3:
-					     - scalar_product((1-fem_properties.structure_theta)*S_old*transpose(F_old), transpose(grad_phi_i_eta))
-					     )* scratch.fe_values.JxW(q);
-			}
-			if (fem_properties.structure_newton) {
-			  data.cell_rhs(i) += ( -scalar_product(fem_properties.structure_theta*S_star, transpose(grad_phi_i_eta))
-						 +  scalar_product(fem_properties.structure_theta*S_star2*transpose(F_star), transpose(grad_phi_i_eta))
-						)* scratch.fe_values.JxW(q);
-			}
-		      } else { // linear elasticity
-			if (fem_properties.time_dependent) {
-			  data.cell_rhs(i) += (physical_properties.rho_s/time_step *phi_i_eta*old_v
-					       -(1-fem_properties.structure_theta)*(scalar_product(S_old, .5*(grad_phi_i_eta+transpose(grad_phi_i_eta))))
-					       )* scratch.fe_values.JxW(q);
-			}
-		      }
+		  const unsigned int i = displacement_dofs[a];
+		  const Tensor<1,dim,double> &phi_i_eta      	= phi_n[i];
+		  const Tensor<2,dim,double> &grad_phi_i_eta 	= grad_phi_n[i];
+
+		  if (physical_properties.simulation_type==0 || physical_properties.simulation_type==2) {
+		    data.cell_rhs(i) += ((1-theta)*old_rhs_values + theta*rhs_values) *phi_i_eta* JxW;
+		  } else {
+		    data.cell_rhs(i) += ((1-theta)*det_F_old*old_rhs_values + theta*det_F_star*rhs_values) *phi_i_eta* JxW;
+		    // data.cell_rhs(i) += ((1-theta)*old_rhs_values + theta*rhs_values) *phi_i_eta* JxW;
+		  }
+		  if (nonlinear_elasticity) {
+		    if (fem_properties.time_dependent) {
+		      data.cell_rhs(i) += (physical_properties.rho_s/time_step *phi_i_eta*old_v
+					   // Formulation 1: 
+					   // - scalar_product(.5*F_old*S_old, grad_phi_i_eta)
+					   // or
+					   // Formulation 2:
+					   // - scalar_product(.5*F_old*S_old, grad_phi_i_eta)
+					   // - scalar_product(.5*S_star, grad_phi_i_eta)
+					   // or
+					   // Formulation 3:
+					   - scalar_product((1-theta)*S_old*transpose(F_old), transpose(grad_phi_i_eta))
+					   )* JxW;
 		    }
-		  else
-		    {
-		      if (fem_properties.time_dependent) {
-			data.cell_rhs(i) += (-(1-fem_properties.structure_theta)*phi_i_eta_dot*old_v
-					     -1./time_step*phi_i_eta_dot*old_n
-					     ) * scratch.fe_values.JxW(q);
-		      }
+		    if (structure_newton) {
+		      data.cell_rhs(i) += ( -scalar_product(theta*S_star, transpose(grad_phi_i_eta))
+					    +  scalar_product(theta*S_star2*transpose(F_star), transpose(grad_phi_i_eta))
+					    )* JxW;
 		    }
+		  } else { // linear elasticity
+		    if (fem_properties.time_dependent) {
+		      data.cell_rhs(i) += (physical_properties.rho_s/time_step *phi_i_eta*old_v
+					   -(1-theta)*(scalar_product(S_old, symgrad_phi_n[i]))
+					   )* JxW;
+		    }
+		  }
 		}
+	      if (fem_properties.time_dependent)
+		for (unsigned int a=0; a<velocity_dofs.size(); ++a)
+		  {
+		    const unsigned int i = velocity_dofs[a];
+		    const Tensor<1,dim,double> &phi_i_eta_dot  	= phi_v[i];
+		    data.cell_rhs(i) += (-(1-theta)*phi_i_eta_dot*old_v
+					 -1./time_step*phi_i_eta_dot*old_n
+					 ) * JxW;
+		  }
 	      //timer.leave_subsection ();
 	    }
 	}
@@ -390,7 +313,7 @@ void FSIProblem<dim>::assemble_structure_matrix_on_one_cell (const typename DoFH
 	{
 	  if (structure_boundaries[cell->face(face_no)->boundary_indicator()]==Neumann)
 	    {
-	      if ((scratch.mode_type)==state)
+	      if (mode_type==state)
 		{
 		  scratch.fe_face_values.reinit (cell, face_no);
 		  // GET SIDE ID!
@@ -435,7 +358,7 @@ void FSIProblem<dim>::assemble_structure_matrix_on_one_cell (const typename DoFH
 	  //     AssertThrow(dim==2,ExcNotImplemented()); // This scaling factor only makes sense for 1d line integrals.
 	  //     std::vector<double> coordinate_transformation_multiplier_old(scratch.n_face_q_points);
 	  //     std::vector<double> coordinate_transformation_multiplier_star(scratch.n_face_q_points);
-	  //     if (physical_properties.nonlinear_elasticity) {
+	  //     if (nonlinear_elasticity) {
 	  // 	std::vector<Tensor<2,dim,double>  > face_grad_n_star (scratch.n_face_q_points, Tensor<2,dim,double>());
 	  // 	std::vector<Tensor<2,dim,double>  > face_grad_n_old (scratch.n_face_q_points, Tensor<2,dim,double>());
 	  // 	scratch.fe_face_values[displacements].get_function_gradients(old_solution.block(1),face_grad_n_old);
@@ -453,7 +376,7 @@ void FSIProblem<dim>::assemble_structure_matrix_on_one_cell (const typename DoFH
 	  // 	coordinate_transformation_multiplier_star = coordinate_transformation_multiplier_old;
 	  //     }
 
-	  //     if ((scratch.mode_type)==state)
+	  //     if (mode_type==state)
 	  // 	{
 	  // 	  scratch.fe_face_values.get_function_values (stress.block(1), g_stress_values);
 
@@ -481,7 +404,7 @@ void FSIProblem<dim>::assemble_structure_matrix_on_one_cell (const typename DoFH
 	  // 		}
 	  // 	    }
 	  // 	}
-	  //     else if ((scratch.mode_type)==adjoint)
+	  //     else if (mode_type==adjoint)
 	  // 	{
 	  // 	  scratch.fe_face_values.get_function_values (rhs_for_adjoint.block(1), adjoint_rhs_values);
 
@@ -524,7 +447,7 @@ void FSIProblem<dim>::assemble_structure_matrix_on_one_cell (const typename DoFH
 
 	  // 	    }
 	  // 	}
-	  //     else // (scratch.mode_type)==linear
+	  //     else // mode_type==linear
 	  // 	{
 	  // 	  scratch.fe_face_values.get_function_values (rhs_for_linear.block(1), linear_rhs_values);
 	  // 	  for (unsigned int q=0; q<scratch.n_face_q_points; ++q)
@@ -568,9 +491,31 @@ void FSIProblem<dim>::copy_local_structure_to_global (const PerTaskData<dim>& da
     }
 }
 
+template <int dim>
+typename FSIProblem<dim>::StructureCellKernel FSIProblem<dim>::structure_cell_kernel (const Mode enum_) const
+{
+  // Specializations of the structure cell kernel indexed by [mode][nonlinear_elasticity][structure_newton]
+  static const StructureCellKernel kernels[3][2][2] =
+    {
+      {{&FSIProblem<dim>::template assemble_structure_matrix_on_one_cell<state,false,false>,
+	&FSIProblem<dim>::template assemble_structure_matrix_on_one_cell<state,false,true>},
+       {&FSIProblem<dim>::template assemble_structure_matrix_on_one_cell<state,true,false>,
+	&FSIProblem<dim>::template assemble_structure_matrix_on_one_cell<state,true,true>}},
+      {{&FSIProblem<dim>::template assemble_structure_matrix_on_one_cell<adjoint,false,false>,
+	&FSIProblem<dim>::template assemble_structure_matrix_on_one_cell<adjoint,false,true>},
+       {&FSIProblem<dim>::template assemble_structure_matrix_on_one_cell<adjoint,true,false>,
+	&FSIProblem<dim>::template assemble_structure_matrix_on_one_cell<adjoint,true,true>}},
+      {{&FSIProblem<dim>::template assemble_structure_matrix_on_one_cell<linear,false,false>,
+	&FSIProblem<dim>::template assemble_structure_matrix_on_one_cell<linear,false,true>},
+       {&FSIProblem<dim>::template assemble_structure_matrix_on_one_cell<linear,true,false>,
+	&FSIProblem<dim>::template assemble_structure_matrix_on_one_cell<linear,true,true>}}
+    };
+  return kernels[enum_][physical_properties.nonlinear_elasticity][fem_properties.structure_newton];
+}
+
 template <int dim>
 void FSIProblem<dim>::assemble_structure_stresses_on_one_cell (const typename DoFHandler<dim>::active_cell_iterator& cell,
-						       FullScratchData<dim>& scratch,
+						       StructureScratchData<dim>& scratch,
 						       PerTaskData<dim>& data )
 {
   unsigned int state=0, adjoint=1, linear=2;
@@ -578,9 +523,9 @@ void FSIProblem<dim>::assemble_structure_stresses_on_one_cell (const typename Do
   const FEValuesExtractors::Vector displacements (0);
   const FEValuesExtractors::Vector velocities (dim);
 
-  std::vector<Vector<double> > g_stress_values(scratch.n_face_q_points, Vector<double>(2*dim));
-  std::vector<Vector<double> > adjoint_rhs_values(scratch.n_face_q_points, Vector<double>(2*dim));
-  std::vector<Vector<double> > linear_rhs_values(scratch.n_face_q_points, Vector<double>(2*dim));
+  std::vector<Vector<double> > &g_stress_values = scratch.g_stress_values;
+  std::vector<Vector<double> > &adjoint_rhs_values = scratch.adjoint_rhs_values;
+  std::vector<Vector<double> > &linear_rhs_values = scratch.linear_rhs_values;
 
   data.cell_rhs*=0;
 
@@ -595,11 +540,11 @@ void FSIProblem<dim>::assemble_structure_stresses_on_one_cell (const typename Do
 	      scratch.fe_face_values.reinit (cell, face_no);
 
 	      AssertThrow(dim==2,ExcNotImplemented()); // This scaling factor only makes sense for 1d line integrals.
-	      std::vector<double> coordinate_transformation_multiplier_old(scratch.n_face_q_points);
-	      std::vector<double> coordinate_transformation_multiplier_star(scratch.n_face_q_points);
+	      std::vector<double> &coordinate_transformation_multiplier_old = scratch.coordinate_transformation_multiplier_old;
+	      std::vector<double> &coordinate_transformation_multiplier_star = scratch.coordinate_transformation_multiplier_star;
 	      if (physical_properties.nonlinear_elasticity) {
-		std::vector<Tensor<2,dim,double>  > face_grad_n_star (scratch.n_face_q_points, Tensor<2,dim,double>());
-		std::vector<Tensor<2,dim,double>  > face_grad_n_old (scratch.n_face_q_points, Tensor<2,dim,double>());
+		std::vector<Tensor<2,dim,double>  > &face_grad_n_star = scratch.face_grad_n_star;
+		std::vector<Tensor<2,dim,double>  > &face_grad_n_old = scratch.face_grad_n_old;
 		scratch.fe_face_values[displacements].get_function_gradients(old_solution.block(1),face_grad_n_old);
 		scratch.fe_face_values[displacements].get_function_gradients(solution_star.block(1),face_grad_n_star);
 		for (unsigned int q=0; q<scratch.n_face_q_points; ++q)
@@ -721,7 +666,16 @@ void FSIProblem<dim>::assemble_structure (Mode enum_, bool assemble_matrix)
     }
   else if (enum_==adjoint)
     {
-      structure_matrix = &adjoint_matrix.block(1,1);
+      if (fem_properties.transposed_adjoint)
+	{
+	  // The adjoint operator is the transpose of the linearized one and is never assembled
+	  AssertThrow(!assemble_matrix, ExcMessage("The adjoint matrix is not assembled with transposed adjoint solves."));
+	  structure_matrix = &linear_matrix.block(1,1);
+	}
+      else
+	{
+	  structure_matrix = &adjoint_matrix.block(1,1);
+	}
       structure_rhs = &adjoint_rhs.block(1);
     }
   else
@@ -772,16 +726,15 @@ void FSIProblem<dim>::assemble_structure (Mode enum_, bool assemble_matrix)
     face_update_flags = face_update_flags | update_gradients;
   }
 
-  FullScratchData<dim> scratch_data(structure_fe, quadrature_formula, update_values | update_gradients | update_quadrature_points | update_JxW_values,
-				    face_quadrature_formula, face_update_flags, (unsigned int)enum_);
+  StructureScratchData<dim> scratch_data(structure_fe, quadrature_formula, update_values | update_gradients | update_quadrature_points | update_JxW_values,
+				    face_quadrature_formula, face_update_flags, (unsigned int)enum_, physical_properties);
 
-  WorkStream::run (structure_dof_handler.begin_active(),
-		   structure_dof_handler.end(),
-		   *this,
-		   &FSIProblem<dim>::assemble_structure_matrix_on_one_cell,
-		   &FSIProblem<dim>::copy_local_structure_to_global,
-		   scratch_data,
-		   per_task_data);
+  run_assembly (structure_dof_handler,
+		structure_colors,
+		structure_cell_kernel(enum_),
+		&FSIProblem<dim>::copy_local_structure_to_global,
+		scratch_data,
+		per_task_data);
 
   QTrapez<dim> vertices_quadrature_formula;
   FEValues<dim> fe_vertices_values (structure_fe, vertices_quadrature_formula,
@@ -813,15 +766,17 @@ void FSIProblem<dim>::assemble_structure (Mode enum_, bool assemble_matrix)
       }
   }
 
-  if (fem_properties.optimization_method.compare("DN")!=0)
+  if (fem_properties.optimization_method.compare("DN")!=0 && fem_properties.optimization_method.compare("Monolithic")!=0)
     {
-      WorkStream::run (structure_dof_handler.begin_active(),
-		       structure_dof_handler.end(),
-		       *this,
-		       &FSIProblem<dim>::assemble_structure_stresses_on_one_cell,
-		       &FSIProblem<dim>::copy_local_structure_to_global,
-		       scratch_data,
-		       per_task_data);
+      run_assembly (structure_dof_handler,
+		    structure_colors,
+		    &FSIProblem<dim>::assemble_structure_stresses_on_one_cell,
+		    &FSIProblem<dim>::copy_local_structure_to_global,
+		    scratch_data,
+		    per_task_data);
+      // Later applications of the linearized operator rebuild these interface terms from it
+      if (assemble_matrix && enum_!=state)
+	assemble_structure_interface_mass_matrix();
     }
 
   visited_vertices.clear();
@@ -849,12 +804,10 @@ void FSIProblem<dim>::assemble_structure (Mode enum_, bool assemble_matrix)
 }
 template void FSIProblem<2>::structure_state_solve(unsigned int initialized_timestep_number);
 
-template void FSIProblem<2>::assemble_structure_matrix_on_one_cell (const DoFHandler<2>::active_cell_iterator& cell,
-							     FullScratchData<2>& scratch,
-							     PerTaskData<2>& data );
+template FSIProblem<2>::StructureCellKernel FSIProblem<2>::structure_cell_kernel (const Mode enum_) const;
 
 template void FSIProblem<2>::assemble_structure_stresses_on_one_cell (const DoFHandler<2>::active_cell_iterator& cell,
-							     FullScratchData<2>& scratch,
+							     StructureScratchData<2>& scratch,
 							     PerTaskData<2>& data );
 
 template void FSIProblem<2>::copy_local_structure_to_global (const PerTaskData<2> &data);
@@ -0,0 +1,223 @@
+#ifndef COUPLING_ACCELERATION_H
+#define COUPLING_ACCELERATION_H
+#include <deal.II/lac/vector.h>
+#include <deal.II/base/std_cxx1x/function.h>
+#include <deque>
+#include <string>
+#include <cmath>
+
+using namespace dealii;
+
+// Update of the interface unknowns of a partitioned (Dirichlet-Neumann) coupling iteration
+// x_{k+1} = update(x_k, H(x_k)), where H is one fluid solve followed by one structure solve
+// and r_k = H(x_k) - x_k is the interface residual.
+//
+// "constant": x_{k+1} = x_k + omega r_k
+// "Aitken":   x_{k+1} = x_k + omega_k r_k with the dynamic factor
+//             omega_k = -omega_{k-1} (r_{k-1}, r_k - r_{k-1}) / |r_k - r_{k-1}|^2
+// "IQN-ILS":  interface quasi-Newton with an inverse Jacobian of r built by least squares from
+//             the differences of past residuals (V) and of past outputs H(x) (W):
+//             c = argmin |V c + r_k|, x_{k+1} = H(x_k) + W c
+// "Anderson": Anderson mixing of depth m with mixing factor omega. With the input differences
+//             U = W - V this is x_{k+1} = x_k + omega r_k + (U + omega V) c for the same c,
+//             so omega = 1 and an unlimited depth is IQN-ILS again.
+//
+// Every method starts a time step with omega_0 = omega. Secant columns of the last reuse_steps
+// time steps are kept and used in the following time steps. Inner products are those given to
+// set_inner_product (Euclidean by default).
+class CouplingAccelerator
+{
+ public:
+ CouplingAccelerator(): omega(1.0), reuse_steps(0), depth(0), time_step_index(0), have_previous(false), aitken_omega(1.0) {};
+
+  void initialize (const std::string &method_, const double omega_, const unsigned int reuse_steps_,
+		   const unsigned int depth_=0)
+  {
+    method = method_;
+    omega = omega_;
+    reuse_steps = reuse_steps_;
+    depth = depth_;
+    time_step_index = 0;
+    clear();
+  }
+
+  void set_inner_product (const std_cxx1x::function<double (const Vector<double> &, const Vector<double> &)> &inner_product_)
+  {
+    inner_product = inner_product_;
+  }
+
+  void clear ()
+  {
+    V.clear();
+    W.clear();
+    column_time_step.clear();
+    have_previous = false;
+  }
+
+  // Differences are not formed across time steps; secant columns older than
+  // reuse_steps time steps are dropped
+  void new_time_step ()
+  {
+    ++time_step_index;
+    have_previous = false;
+    while (!column_time_step.empty() && column_time_step.back() + reuse_steps < time_step_index)
+      {
+	V.pop_back();
+	W.pop_back();
+	column_time_step.pop_back();
+      }
+  }
+
+  unsigned int n_columns () const
+  {
+    return V.size();
+  }
+
+  // x: input of the current coupling iteration, x_tilde: its output H(x), x_new: next input
+  void update (const Vector<double> &x, const Vector<double> &x_tilde, Vector<double> &x_new)
+  {
+    Vector<double> residual(x_tilde);
+    residual -= x;
+
+    if (method.compare("Aitken")==0)
+      {
+	if (have_previous)
+	  {
+	    Vector<double> residual_difference(residual);
+	    residual_difference -= previous_residual;
+	    const double denominator = dot(residual_difference, residual_difference);
+	    if (denominator > 0)
+	      aitken_omega *= -dot(previous_residual, residual_difference)/denominator;
+	  }
+	else
+	  aitken_omega = omega;
+	previous_residual = residual;
+	have_previous = true;
+
+	x_new = x;
+	x_new.add(aitken_omega, residual);
+	return;
+      }
+
+    if (method.compare("IQN-ILS")==0 || method.compare("Anderson")==0)
+      {
+	if (have_previous)
+	  {
+	    // Newest column first so that the QR filter below keeps the most recent information
+	    V.push_front(residual);
+	    V.front() -= previous_residual;
+	    W.push_front(x_tilde);
+	    W.front() -= previous_x_tilde;
+	    column_time_step.push_front(time_step_index);
+	  }
+	previous_residual = residual;
+	previous_x_tilde = x_tilde;
+	have_previous = true;
+
+	if (method.compare("Anderson")==0)
+	  while (V.size() > depth)
+	    {
+	      V.pop_back();
+	      W.pop_back();
+	      column_time_step.pop_back();
+	    }
+
+	std::vector<double> c;
+	if (least_squares(residual, c))
+	  {
+	    if (method.compare("IQN-ILS")==0)
+	      {
+		x_new = x_tilde;
+		for (unsigned int j=0; j<c.size(); ++j)
+		  x_new.add(c[j], W[j]);
+	      }
+	    else
+	      {
+		x_new = x;
+		x_new.add(omega, residual);
+		for (unsigned int j=0; j<c.size(); ++j)
+		  x_new.add(c[j], W[j], (omega-1)*c[j], V[j]);
+	      }
+	    return;
+	  }
+      }
+
+    x_new = x;
+    x_new.add(omega, residual);
+  }
+
+ private:
+  double dot (const Vector<double> &a, const Vector<double> &b) const
+  {
+    if (inner_product) return inner_product(a, b);
+    return a*b;
+  }
+
+  // Solves min |V c + r| by a modified Gram-Schmidt QR of V; columns (nearly) dependent
+  // on newer ones are removed from V and W. Returns false if no column is left.
+  bool least_squares (const Vector<double> &r, std::vector<double> &c)
+  {
+    const double drop_tolerance = 1e-10;
+    while (V.size() > r.size())
+      {
+	V.pop_back();
+	W.pop_back();
+	column_time_step.pop_back();
+      }
+
+    std::vector<Vector<double> > Q;
+    std::vector<std::vector<double> > R;
+    for (unsigned int j=0; j<V.size(); )
+      {
+	Vector<double> q(V[j]);
+	const double original_norm = std::sqrt(dot(q, q));
+	std::vector<double> R_column(Q.size()+1, 0.);
+	for (unsigned int i=0; i<Q.size(); ++i)
+	  {
+	    R_column[i] = dot(Q[i], q);
+	    q.add(-R_column[i], Q[i]);
+	  }
+	const double norm = std::sqrt(dot(q, q));
+	if (norm <= drop_tolerance*original_norm || original_norm == 0)
+	  {
+	    V.erase(V.begin()+j);
+	    W.erase(W.begin()+j);
+	    column_time_step.erase(column_time_step.begin()+j);
+	    continue;
+	  }
+	q /= norm;
+	R_column[Q.size()] = norm;
+	Q.push_back(q);
+	R.push_back(R_column);
+	++j;
+      }
+    if (Q.size()==0) return false;
+
+    // R c = -Q^T r, R upper triangular and stored by columns
+    const unsigned int m = Q.size();
+    c.assign(m, 0.);
+    for (unsigned int i=0; i<m; ++i)
+      c[i] = -dot(Q[i], r);
+    for (int i=m-1; i>=0; --i)
+      {
+	for (unsigned int j=i+1; j<m; ++j)
+	  c[i] -= R[j][i]*c[j];
+	c[i] /= R[i][i];
+      }
+    return true;
+  }
+
+  std::string method;
+  double omega;
+  unsigned int reuse_steps;
+  unsigned int depth;
+  unsigned int time_step_index;
+  bool have_previous;
+  double aitken_omega;
+  std_cxx1x::function<double (const Vector<double> &, const Vector<double> &)> inner_product;
+  Vector<double> previous_residual, previous_x_tilde;
+  std::deque<Vector<double> > V, W;
+  std::deque<unsigned int> column_time_step;
+};
+
+#endif
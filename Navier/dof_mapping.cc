@@ -152,107 +152,115 @@ void FSIProblem<dim>::build_dof_mapping()
   }
   for (unsigned int i=0; i<f_a.size(); ++i)
     {
-      f2n.insert(std::pair<unsigned int,unsigned int>(f_a[i].dof,n_a[i].dof));
-      n2f.insert(std::pair<unsigned int,unsigned int>(n_a[i].dof,f_a[i].dof));
-      f2v.insert(std::pair<unsigned int,unsigned int>(f_a[i].dof,v_a[i].dof));
-      v2f.insert(std::pair<unsigned int,unsigned int>(v_a[i].dof,f_a[i].dof));
-      n2a.insert(std::pair<unsigned int,unsigned int>(n_a[i].dof,a_a[i].dof));
-      a2n.insert(std::pair<unsigned int,unsigned int>(a_a[i].dof,n_a[i].dof));
-      v2a.insert(std::pair<unsigned int,unsigned int>(v_a[i].dof,a_a[i].dof));
-      a2v.insert(std::pair<unsigned int,unsigned int>(a_a[i].dof,v_a[i].dof));
-      a2f.insert(std::pair<unsigned int,unsigned int>(a_a[i].dof,f_a[i].dof));
-      f2a.insert(std::pair<unsigned int,unsigned int>(f_a[i].dof,a_a[i].dof));
-      v2n.insert(std::pair<unsigned int,unsigned int>(v_a[i].dof,n_a[i].dof));
-      n2v.insert(std::pair<unsigned int,unsigned int>(n_a[i].dof,v_a[i].dof));
+      f2n.add(f_a[i].dof,n_a[i].dof);
+      n2f.add(n_a[i].dof,f_a[i].dof);
+      f2v.add(f_a[i].dof,v_a[i].dof);
+      v2f.add(v_a[i].dof,f_a[i].dof);
+      n2a.add(n_a[i].dof,a_a[i].dof);
+      a2n.add(a_a[i].dof,n_a[i].dof);
+      v2a.add(v_a[i].dof,a_a[i].dof);
+      a2v.add(a_a[i].dof,v_a[i].dof);
+      a2f.add(a_a[i].dof,f_a[i].dof);
+      f2a.add(f_a[i].dof,a_a[i].dof);
+      v2n.add(v_a[i].dof,n_a[i].dof);
+      n2v.add(n_a[i].dof,v_a[i].dof);
     }
   for (unsigned int i=0; i<f_all.size(); ++i)
     {
-      a2f_all.insert(std::pair<unsigned int,unsigned int>(a_all[i].dof,f_all[i].dof));
-      f2a_all.insert(std::pair<unsigned int,unsigned int>(f_all[i].dof,a_all[i].dof));
+      a2f_all.add(a_all[i].dof,f_all[i].dof);
+      f2a_all.add(f_all[i].dof,a_all[i].dof);
     }
+  f2n.compress(); n2f.compress(); f2v.compress(); v2f.compress();
+  n2a.compress(); a2n.compress(); v2a.compress(); a2v.compress();
+  a2f.compress(); f2a.compress(); v2n.compress(); n2v.compress();
+  a2f_all.compress(); f2a_all.compress();
+
+  structure_interface_dofs = n2f.from;
+  structure_interface_dofs.insert(structure_interface_dofs.end(), v2f.from.begin(), v2f.from.end());
+  std::sort(structure_interface_dofs.begin(), structure_interface_dofs.end());
+  structure_interface_dofs.erase(std::unique(structure_interface_dofs.begin(), structure_interface_dofs.end()),
+				 structure_interface_dofs.end());
+  interface_displacement_index.resize(f2n.size());
+  for (unsigned int k=0; k<f2n.size(); ++k)
+    interface_displacement_index[k] = std::lower_bound(structure_interface_dofs.begin(), structure_interface_dofs.end(), f2n.to[k])
+      - structure_interface_dofs.begin();
 }
 
 
 template <int dim>
 void FSIProblem<dim>::transfer_all_dofs(BlockVector<double> & solution_1, BlockVector<double> & solution_2, unsigned int from, unsigned int to)
 {
-  std::map<unsigned int, unsigned int> mapping;
   if (from==2 && to==0)
     {
-      mapping = a2f_all;
+      a2f_all.transfer(solution_1.block(from), solution_2.block(to));
     }
   else if (from==0 && to==2)
     {
-      mapping = f2a_all;
+      f2a_all.transfer(solution_1.block(from), solution_2.block(to));
     }
   else
     {
       AssertThrow(false,ExcNotImplemented());
     }
-  for  (std::map<unsigned int, unsigned int>::iterator it=mapping.begin(); it!=mapping.end(); ++it)
-    {
-      solution_2.block(to)[it->second]=solution_1.block(from)[it->first];
-    }
 }
 
 template <int dim>
-void FSIProblem<dim>::transfer_interface_dofs(const BlockVector<double> & solution_1, BlockVector<double> & solution_2, unsigned int from, unsigned int to, StructureComponent structure_var_1, StructureComponent structure_var_2)
+const InterfaceMap & FSIProblem<dim>::interface_map(unsigned int from, unsigned int to, StructureComponent structure_var_1, StructureComponent structure_var_2) const
 {
-  std::map<unsigned int, unsigned int> mapping;
   if (from==1) // structure origin
     {
       if (structure_var_1==Displacement || structure_var_1==NotSet)
 	{
 	  if (to==0)
 	    {
-	      mapping = n2f;
+	      return n2f;
 	    }
 	  else if (to==1)
 	    {
 	      if (structure_var_2==Displacement)
 		{
-		  mapping = n2a; //  not the correct mapping, just a place holder 
+		  return n2a; //  not the correct mapping, just a place holder 
 		}
 	      else if (structure_var_2==Velocity)
 		{
-		  mapping = n2v;
+		  return n2v;
 		}
 	      else
 		{
-		  mapping = n2a; // this is a place holder, but makes the assumption that they want to transfer displacements
+		  return n2a; // this is a place holder, but makes the assumption that they want to transfer displacements
 		  //AssertThrow(false,ExcNotImplemented());// 'transfer_interface_dofs needs to know which component of the structure you wish to transfer to.');
 		}
 	    }
 	  else // to==2
 	    {
-	      mapping = n2a;
+	      return n2a;
 	    }
 	}
       else if (structure_var_1==Velocity)
 	{
 	  if (to==0)
 	    {
-	      mapping = v2f;
+	      return v2f;
 	    }
 	  else if (to==1)
 	    {
 	      if (structure_var_2==Displacement)
 		{
-		  mapping = v2n;  
+		  return v2n;  
 		}
 	      else if (structure_var_2==Velocity)
 		{
-		  mapping = v2a; //  not the correct mapping, just a place holder
+		  return v2a; //  not the correct mapping, just a place holder
 		}
 	      else
 		{
-		  mapping = v2a; // placeholder and assume that they want velocity -> velocity
+		  return v2a; // placeholder and assume that they want velocity -> velocity
 		  //AssertThrow(false,ExcNotImplemented()); // 'transfer_interface_dofs needs to know which component of the structure you wish to transfer to.');
 		}
 	    }
 	  else // to==2
 	    {
-	      mapping = v2a;
+	      return v2a;
 	    }
 	}
       // NotSet behaves like choosing Displacement
@@ -265,7 +273,7 @@ void FSIProblem<dim>::transfer_interface_dofs(const BlockVector<double> & soluti
     {
       if (to==0)
 	{
-	  mapping = a2f;
+	  return a2f;
 	}
       else if (to==1)
 	{
@@ -274,15 +282,15 @@ void FSIProblem<dim>::transfer_interface_dofs(const BlockVector<double> & soluti
 	      // we must find which one is not the notset and use that
 	      if (structure_var_1==Displacement || structure_var_2==Displacement)
 		{
-		  mapping = a2n;
+		  return a2n;
 		}
 	      else if (structure_var_1==Velocity || structure_var_2==Velocity)
 		{
-		  mapping = a2v;
+		  return a2v;
 		}
 	      else // both are NotSet
 		{
-		  mapping = a2n; // assume they want to send to displacement
+		  return a2n; // assume they want to send to displacement
 		  //AssertThrow(false,ExcNotImplemented()); // 'transfer_interface_dofs needs to know which component of the structure you wish to transfer to.');
 		}
 	    }
@@ -293,14 +301,14 @@ void FSIProblem<dim>::transfer_interface_dofs(const BlockVector<double> & soluti
 	}
       else // to == 2
 	{
-	  mapping = a2f; // placeholder since this will get mapped to itself
+	  return a2f; // placeholder since this will get mapped to itself
 	}
     }
   else // fluid origin
     {
       if (to==0)
 	{
-	  mapping = f2n; // placeholder since this will get mapped to itself
+	  return f2n; // placeholder since this will get mapped to itself
 	}
       else if (to==1)
 	{
@@ -309,15 +317,15 @@ void FSIProblem<dim>::transfer_interface_dofs(const BlockVector<double> & soluti
 	      // we must find which one is not the notset and use that
 	      if (structure_var_1==Displacement || structure_var_2==Displacement)
 		{
-		  mapping = f2n;
+		  return f2n;
 		}
 	      else if (structure_var_1==Velocity || structure_var_2==Velocity)
 		{
-		  mapping = f2v;
+		  return f2v;
 		}
 	      else // both are NotSet
 		{
-		  mapping = f2n; // Assume they want displacements
+		  return f2n; // Assume they want displacements
 		  //AssertThrow(false,ExcNotImplemented()); // 'transfer_interface_dofs needs to know which component of the structure you wish to transfer to.');
 		}
 	    }
@@ -328,211 +336,36 @@ void FSIProblem<dim>::transfer_interface_dofs(const BlockVector<double> & soluti
 	}
       else // to==2
 	{
-	  mapping = f2a;
-	}
-    }
-  if (from!=to)
-    {
-      for  (std::map<unsigned int, unsigned int>::iterator it=mapping.begin(); it!=mapping.end(); ++it)
-	{
-	  solution_2.block(to)[it->second]=solution_1.block(from)[it->first];
-	}
-    }
-  else
-    {
-      // if (structure_var_1!=structure_var_2)
-      //   {
-      //     // ERROR COULD BE HERE! HAVE NOT CHECKED THAT THERE ARE NOT NOTSET's available
-      //     solution_2.block(to)[it->second]=solution_1.block(from)[it->first];
-      //   }
-      // else if ( COULD BE both notset and from to are not equal 1      OR if is 1, at least one not set)
-      if ((from==0 || from==2) || (from==1 && (structure_var_1==structure_var_2 || structure_var_2== NotSet)))
-	{ 
-	  for  (std::map<unsigned int, unsigned int>::iterator it=mapping.begin(); it!=mapping.end(); ++it)
-	    {
-	      solution_2.block(to)[it->first]=solution_1.block(from)[it->first];
-	    }
-	}
-      else
-	{
-	  for  (std::map<unsigned int, unsigned int>::iterator it=mapping.begin(); it!=mapping.end(); ++it)
-	    {
-	      solution_2.block(to)[it->second]=solution_1.block(from)[it->first];
-	    }
+	  return f2a;
 	}
     }
+  return f2n;
+}
+
+template <int dim>
+void FSIProblem<dim>::transfer_interface_dofs(const BlockVector<double> & solution_1, BlockVector<double> & solution_2, unsigned int from, unsigned int to, StructureComponent structure_var_1, StructureComponent structure_var_2)
+{
+  vector_vector_transfer_interface_dofs(solution_1.block(from), solution_2.block(to), from, to, structure_var_1, structure_var_2);
 }
 
-// THIS FUNCTION SHOULD BE COMBINED WITH THE PREVIOUS FUNCTION AT SOME POINT (in a more elegant way)
 template <int dim>
 void FSIProblem<dim>::vector_vector_transfer_interface_dofs(const Vector<double> & solution_1, Vector<double> & solution_2, unsigned int from, unsigned int to, StructureComponent structure_var_1, StructureComponent structure_var_2)
 {
-  std::map<unsigned int, unsigned int> mapping;
-  if (from==1) // structure origin
-    {
-      if (structure_var_1==Displacement || structure_var_1==NotSet)
-	{
-	  if (to==0)
-	    {
-	      mapping = n2f;
-	    }
-	  else if (to==1)
-	    {
-	      if (structure_var_2==Displacement)
-		{
-		  mapping = n2a; //  not the correct mapping, just a place holder 
-		}
-	      else if (structure_var_2==Velocity)
-		{
-		  mapping = n2v;
-		}
-	      else
-		{
-		  mapping = n2a; // this is a place holder, but makes the assumption that they want to transfer displacements
-		  //AssertThrow(false,ExcNotImplemented());// 'transfer_interface_dofs needs to know which component of the structure you wish to transfer to.');
-		}
-	    }
-	  else // to==2
-	    {
-	      mapping = n2a;
-	    }
-	}
-      else if (structure_var_1==Velocity)
-	{
-	  if (to==0)
-	    {
-	      mapping = v2f;
-	    }
-	  else if (to==1)
-	    {
-	      if (structure_var_2==Displacement)
-		{
-		  mapping = v2n;  
-		}
-	      else if (structure_var_2==Velocity)
-		{
-		  mapping = v2a; //  not the correct mapping, just a place holder
-		}
-	      else
-		{
-		  mapping = v2a; // placeholder and assume that they want velocity -> velocity
-		  //AssertThrow(false,ExcNotImplemented()); // 'transfer_interface_dofs needs to know which component of the structure you wish to transfer to.');
-		}
-	    }
-	  else // to==2
-	    {
-	      mapping = v2a;
-	    }
-	}
-      // NotSet behaves like choosing Displacement
-      // else // structure_var_1==NotSet
-      //   {
-      //     AssertThrow(false,ExcNotImplemented()); // 'transfer_interface_dofs needs to know which component of the structure you wish to transfer from.');
-      //   }
-    }
-  else if (from==2)
-    {
-      if (to==0)
-	{
-	  mapping = a2f;
-	}
-      else if (to==1)
-	{
-	  if (!(structure_var_1==Displacement && structure_var_2==Velocity) && !(structure_var_1==Velocity && structure_var_2==Displacement))
-	    { // either both are the same and are displacement or velocity, or one is NotSet
-	      // we must find which one is not the notset and use that
-	      if (structure_var_1==Displacement || structure_var_2==Displacement)
-		{
-		  mapping = a2n;
-		}
-	      else if (structure_var_1==Velocity || structure_var_2==Velocity)
-		{
-		  mapping = a2v;
-		}
-	      else // both are NotSet
-		{
-		  mapping = a2n; // assume they want to send to displacement
-		  //AssertThrow(false,ExcNotImplemented()); // 'transfer_interface_dofs needs to know which component of the structure you wish to transfer to.');
-		}
-	    }
-	  else
-	    {
-	      AssertThrow(false,ExcNotImplemented()); //  'transfer_interface_dofs has been given conflicting information about which component of the structure you wish to transfer to.');
-	    }
-	}
-      else // to == 2
-	{
-	  mapping = a2f; // placeholder since this will get mapped to itself
-	}
-    }
-  else // fluid origin
-    {
-      if (to==0)
-	{
-	  mapping = f2n; // placeholder since this will get mapped to itself
-	}
-      else if (to==1)
-	{
-	  if (!(structure_var_1==Displacement && structure_var_2==Velocity) && !(structure_var_1==Velocity && structure_var_2==Displacement))
-	    { // either both are the same and are displacement or velocity, or one is NotSet
-	      // we must find which one is not the notset and use that
-	      if (structure_var_1==Displacement || structure_var_2==Displacement)
-		{
-		  mapping = f2n;
-		}
-	      else if (structure_var_1==Velocity || structure_var_2==Velocity)
-		{
-		  mapping = f2v;
-		}
-	      else // both are NotSet
-		{
-		  mapping = f2n; // Assume they want displacements
-		  //AssertThrow(false,ExcNotImplemented()); // 'transfer_interface_dofs needs to know which component of the structure you wish to transfer to.');
-		}
-	    }
-	  else
-	    {
-	      AssertThrow(false,ExcNotImplemented()); // 'transfer_interface_dofs has been given conflicting information about which component of the structure you wish to transfer to.');
-	    }
-	}
-      else // to==2
-	{
-	  mapping = f2a;
-	}
-    }
-  if (from!=to)
+  const InterfaceMap &mapping = interface_map(from, to, structure_var_1, structure_var_2);
+  // Transfers within the same system either copy the interface entries in place or
+  // move them between the displacement and velocity components of the structure
+  if (from==to && ((from==0 || from==2) || (from==1 && (structure_var_1==structure_var_2 || structure_var_2== NotSet))))
     {
-      for  (std::map<unsigned int, unsigned int>::iterator it=mapping.begin(); it!=mapping.end(); ++it)
-	{
-	  solution_2[it->second]=solution_1[it->first];
-	}
+      mapping.copy(solution_1, solution_2);
     }
   else
     {
-      // if (structure_var_1!=structure_var_2)
-      //   {
-      //     // ERROR COULD BE HERE! HAVE NOT CHECKED THAT THERE ARE NOT NOTSET's available
-      //     solution_2.block(to)[it->second]=solution_1.block(from)[it->first];
-      //   }
-      // else if ( COULD BE both notset and from to are not equal 1      OR if is 1, at least one not set)
-      if ((from==0 || from==2) || (from==1 && (structure_var_1==structure_var_2 || structure_var_2== NotSet)))
-	{ 
-	  for  (std::map<unsigned int, unsigned int>::iterator it=mapping.begin(); it!=mapping.end(); ++it)
-	    {
-	      solution_2[it->first]=solution_1[it->first];
-	    }
-	}
-      else
-	{
-	  for  (std::map<unsigned int, unsigned int>::iterator it=mapping.begin(); it!=mapping.end(); ++it)
-	    {
-	      solution_2[it->second]=solution_1[it->first];
-	    }
-	}
+      mapping.transfer(solution_1, solution_2);
     }
 }
 
 template void FSIProblem<2>::build_dof_mapping();
 template void FSIProblem<2>::transfer_all_dofs(BlockVector<double> & solution_1, BlockVector<double> & solution_2, unsigned int from, unsigned int to);
+template const InterfaceMap & FSIProblem<2>::interface_map(unsigned int from, unsigned int to, StructureComponent structure_var_1, StructureComponent structure_var_2) const;
 template void FSIProblem<2>::transfer_interface_dofs(const BlockVector<double> & solution_1, BlockVector<double> & solution_2, unsigned int from, unsigned int to, StructureComponent structure_var_1, StructureComponent structure_var_2);
 template void FSIProblem<2>::vector_vector_transfer_interface_dofs(const Vector<double> & solution_1, Vector<double> & solution_2, unsigned int from, unsigned int to, StructureComponent structure_var_1, StructureComponent structure_var_2);
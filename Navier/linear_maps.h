@@ -2,13 +2,21 @@
 #define LINEAR_MAPS_H
 #include "FSI_Project.h"
 #include "data1.h"
+#include <deal.II/lac/sparse_ilu.h>
+#include <deal.II/lac/solver_control.h>
+#include <deal.II/lac/full_matrix.h>
+#ifdef DEAL_II_WITH_TRILINOS
+#include <deal.II/lac/trilinos_precondition.h>
+#endif
 
-// temporarily: never let matrix_assembled be true
 // solve ALE in loop
 // 
 
 namespace LinearMap {
 
+  template <int dim>
+    class InterfaceVector;
+
   template <int dim>
     class Linearized_Operator
     {
@@ -65,59 +73,15 @@ namespace LinearMap {
 	//if (!matrix_assembled) total_solves = 0; // restart the count since we are dealing with a new sequence of runs
 	assemble_matrix(dst, src);
 
-	if (matrix_initialized) {
-	  if (mode==problem_space->linear) {
-	    Threads::Task<void> f_solve = Threads::new_task(&FSIProblem<dim>::solve,*problem_space,problem_space->linear_solver[0],0,problem_space->linear);
-	    Threads::Task<void> s_solve = Threads::new_task(&FSIProblem<dim>::solve,*problem_space,problem_space->linear_solver[1],1,problem_space->linear);
-	    f_solve.join();
-	    s_solve.join();
-	  } else { // adjoint
-	    Threads::Task<void> f_solve = Threads::new_task(&FSIProblem<dim>::solve,*problem_space,problem_space->adjoint_solver[0],0,problem_space->adjoint);
-	    Threads::Task<void> s_solve = Threads::new_task(&FSIProblem<dim>::solve,*problem_space,problem_space->adjoint_solver[1],1,problem_space->adjoint);
-	    f_solve.join();
-	    s_solve.join();
-	  }
-	} else {
-	  ExcNotInitialized();
-	}
+	AssertThrow(matrix_initialized, ExcNotInitialized());
+	Threads::Task<void> f_solve = Threads::new_task(&FSIProblem<dim>::solve,*problem_space,direct_solvers()[0],0,mode);
+	Threads::Task<void> s_solve = Threads::new_task(&FSIProblem<dim>::solve,*problem_space,direct_solvers()[1],1,mode);
+	f_solve.join();
+	s_solve.join();
 
 	//total_solves += 2;
 
-	//*************************************************************
-	//      FORM OPERATOR OUTPUT FROM SUBSYSTEM SOLUTIONS
-	//*************************************************************
-	dst *= 0;
-	if (mode==problem_space->linear) {
-	  if (problem_space->fem_properties.adjoint_type==1)
-	    {
-	      // -Ax = -w^n + phi^n/dt	  
-	      Vector<double> tmp(src.size());
-	      problem_space->vector_vector_transfer_interface_dofs(problem_space->linear_solution.block(1),dst,1,0,problem_space->Displacement);
-	      dst*=1./problem_space->time_step;
-	      problem_space->vector_vector_transfer_interface_dofs(problem_space->linear_solution.block(0),tmp,0,0);
-	      dst-=tmp;
-	    }
-	  else
-	    {
-	      // -Ax = -w^n + phi_dot^n
-	      Vector<double> tmp(src.size());
-	      problem_space->vector_vector_transfer_interface_dofs(problem_space->linear_solution.block(1),dst,1,0,problem_space->Velocity);
-	      problem_space->vector_vector_transfer_interface_dofs(problem_space->linear_solution.block(0),tmp,0,0);
-	      dst-=tmp;
-	    }
-	} else {//adjoint 
-	  Vector<double> tmp(src.size());
-	  if (problem_space->fem_properties.adjoint_type==1)
-	    {
-	      problem_space->vector_vector_transfer_interface_dofs(problem_space->adjoint_solution.block(1),dst,1,0,problem_space->Displacement);
-	    }
-	  else
-	    {
-	      problem_space->vector_vector_transfer_interface_dofs(problem_space->adjoint_solution.block(1),dst,1,0,problem_space->Velocity);
-	    }
-	  dst *= problem_space->fem_properties.structure_theta;
-	  dst.add(-problem_space->fem_properties.fluid_theta,problem_space->adjoint_solution.block(0));
-	}
+	form_output(dst);
 
       /* 	problem_space->old_old_solution.block(0)*=0; */
       /* 	problem_space->vector_vector_transfer_interface_dofs(problem_space->adjoint_solution.block(1),problem_space->old_old_solution.block(0),1,0,problem_space->Displacement); */
@@ -129,6 +93,19 @@ namespace LinearMap {
     };
 
 
+    // Application to a vector holding only the interface dofs.
+    // The vectors are expanded to the full fluid block only for the subsystem solves.
+    void vmult (InterfaceVector<dim> &dst,
+		const InterfaceVector<dim> &src) const {
+      Vector<double> full_src(problem_space->dofs_per_big_block[0]);
+      Vector<double> full_dst(problem_space->dofs_per_big_block[0]);
+      src.distribute(full_src);
+      vmult(full_dst, full_src);
+      dst.reinit(src, true);
+      dst.extract(full_dst);
+    };
+
+
     // Application of transpose to a vector.
     // Only used by some iterative methods.
     void Tvmult (Vector<double> &dst,
@@ -138,18 +115,20 @@ namespace LinearMap {
 
 
 
+    // Assemble the linearized (or adjoint) subsystem matrices and factor them.
+    // Until the matrices are reassembled, vmult only rebuilds the interface right hand side
+    // and back-substitutes with these factors.
     void initialize_matrix(Vector<double> &dst,
 			   const Vector<double> &src, enum FSIProblem<dim>::Mode mode_, unsigned int initialized_timestep_number_) {
       mode = mode_;
-      reassemble_operator(dst, src);
-      if (mode==problem_space->linear) {
-	problem_space->linear_solver[0].initialize(problem_space->linear_matrix.block(0,0));
-	problem_space->linear_solver[1].initialize(problem_space->linear_matrix.block(1,1));
-      } else { //adjoint
-	problem_space->adjoint_solver[0].initialize(problem_space->adjoint_matrix.block(0,0));
-	problem_space->adjoint_solver[1].initialize(problem_space->adjoint_matrix.block(1,1));
-      }
+      matrix_assembled = false;
+      assemble_matrix(dst, src);
+      Threads::Task<void> f_factor = Threads::new_task(&SparseDirectUMFPACK::initialize<SparseMatrix<double> >,direct_solvers()[0], operator_matrix().block(0,0), SparseDirectUMFPACK::AdditionalData());
+      Threads::Task<void> s_factor = Threads::new_task(&SparseDirectUMFPACK::initialize<SparseMatrix<double> >,direct_solvers()[1], operator_matrix().block(1,1), SparseDirectUMFPACK::AdditionalData());
+      f_factor.join();
+      s_factor.join();
       matrix_initialized = true;
+      matrix_assembled = true;
       initialized_timestep_number = initialized_timestep_number_;
     };      
 
@@ -172,30 +151,55 @@ namespace LinearMap {
 	problem_space->rhs_for_adjoint.block(1) *= -1;
       }
 
-      // only assembly the matrix operator if it isn't currently assembled (once each time step)
-      Threads::Task<void> s_assembly = Threads::new_task(&FSIProblem<dim>::assemble_structure, *problem_space, mode, !matrix_assembled);
-      Threads::Task<void> f_assembly = Threads::new_task(&FSIProblem<dim>::assemble_fluid, *problem_space, mode, !matrix_assembled);	      
-      f_assembly.join();
-      problem_space->dirichlet_boundaries(static_cast<enum FSIProblem<dim>::System >(0), mode);
-      s_assembly.join();
-      problem_space->dirichlet_boundaries(static_cast<enum FSIProblem<dim>::System >(1), mode);
+      // The operator is assembled once each outer iteration. With transposed adjoint solves
+      // the linearized matrices stand in for the adjoint ones.
+      if (!matrix_assembled) {
+	const enum FSIProblem<dim>::Mode assembly_mode = transposed_adjoint() ? problem_space->linear : mode;
+	Threads::Task<void> s_assembly = Threads::new_task(&FSIProblem<dim>::assemble_structure, *problem_space, assembly_mode, true);
+	Threads::Task<void> f_assembly = Threads::new_task(&FSIProblem<dim>::assemble_fluid, *problem_space, assembly_mode, true);	      
+	f_assembly.join();
+	problem_space->dirichlet_boundaries(static_cast<enum FSIProblem<dim>::System >(0), assembly_mode);
+	s_assembly.join();
+	problem_space->dirichlet_boundaries(static_cast<enum FSIProblem<dim>::System >(1), assembly_mode);
+
+	std::map<types::global_dof_index,double> boundary_values;
+	problem_space->linearized_boundary_values(static_cast<enum FSIProblem<dim>::System >(0), boundary_values);
+	fluid_boundary_dofs.clear();
+	for (typename std::map<types::global_dof_index,double>::const_iterator it=boundary_values.begin();
+	     it!=boundary_values.end(); ++it)
+	  fluid_boundary_dofs.push_back(it->first);
+	boundary_values.clear();
+	problem_space->linearized_boundary_values(static_cast<enum FSIProblem<dim>::System >(1), boundary_values);
+	structure_boundary_dofs.clear();
+	for (typename std::map<types::global_dof_index,double>::const_iterator it=boundary_values.begin();
+	     it!=boundary_values.end(); ++it)
+	  structure_boundary_dofs.push_back(it->first);
+	if (!transposed_adjoint()) return;
+      }
+
+      // Only the interface terms of the right hand side depend on src. The Dirichlet rows of
+      // the factored matrices are already unit rows, so their (homogeneous) entries are set directly.
+      problem_space->assemble_interface_rhs(mode);
+      BlockVector<double> &rhs = (mode==problem_space->linear) ? problem_space->linear_rhs : problem_space->adjoint_rhs;
+      for (unsigned int k=0; k<fluid_boundary_dofs.size(); ++k)
+	rhs.block(0)(fluid_boundary_dofs[k]) = 0;
+      for (unsigned int k=0; k<structure_boundary_dofs.size(); ++k)
+	rhs.block(1)(structure_boundary_dofs[k]) = 0;
     };
 
+    // Rebuild the matrices and factor them again. SparseDirectUMFPACK::factorize repeats the
+    // symbolic analysis as well, so this costs as much as initialize_matrix.
+    // Only needed if the linearization point changed within the outer iteration.
     void reassemble_operator(Vector<double> &dst,
 		const Vector<double> &src) {
+      AssertThrow (matrix_initialized, ExcNotInitialized());
+      matrix_assembled = false;
       assemble_matrix(dst, src);
-      if (mode==problem_space->linear) {
-	Threads::Task<void> f_factor = Threads::new_task(&SparseDirectUMFPACK::factorize<SparseMatrix<double> >,problem_space->linear_solver[0], problem_space->linear_matrix.block(0,0));
-	Threads::Task<void> s_factor = Threads::new_task(&SparseDirectUMFPACK::factorize<SparseMatrix<double> >,problem_space->linear_solver[1], problem_space->linear_matrix.block(1,1));
-	f_factor.join();
-	s_factor.join();
-      } else { // adjoint
-	Threads::Task<void> f_factor = Threads::new_task(&SparseDirectUMFPACK::factorize<SparseMatrix<double> >,problem_space->adjoint_solver[0], problem_space->adjoint_matrix.block(0,0));
-	Threads::Task<void> s_factor = Threads::new_task(&SparseDirectUMFPACK::factorize<SparseMatrix<double> >,problem_space->adjoint_solver[1], problem_space->adjoint_matrix.block(1,1));
-	f_factor.join();
-	s_factor.join();
-      }
-      //matrix_assembled = true;
+      Threads::Task<void> f_factor = Threads::new_task(&SparseDirectUMFPACK::factorize<SparseMatrix<double> >,direct_solvers()[0], operator_matrix().block(0,0));
+      Threads::Task<void> s_factor = Threads::new_task(&SparseDirectUMFPACK::factorize<SparseMatrix<double> >,direct_solvers()[1], operator_matrix().block(1,1));
+      f_factor.join();
+      s_factor.join();
+      matrix_assembled = true;
     };
 
     void set_matrix_assembled_false() {
@@ -203,12 +207,173 @@ namespace LinearMap {
     };
 
     private:
+      // Operator output from the fluid and structure solutions of the current mode
+      void form_output (Vector<double> &dst) const {
+	//*************************************************************
+	//      FORM OPERATOR OUTPUT FROM SUBSYSTEM SOLUTIONS
+	//*************************************************************
+	dst *= 0;
+	if (mode==problem_space->linear) {
+	  if (problem_space->fem_properties.adjoint_type==1)
+	    {
+	      // -Ax = -w^n + phi^n/dt	  
+	      Vector<double> tmp(dst.size());
+	      problem_space->vector_vector_transfer_interface_dofs(problem_space->linear_solution.block(1),dst,1,0,problem_space->Displacement);
+	      dst*=1./problem_space->time_step;
+	      problem_space->vector_vector_transfer_interface_dofs(problem_space->linear_solution.block(0),tmp,0,0);
+	      dst-=tmp;
+	    }
+	  else
+	    {
+	      // -Ax = -w^n + phi_dot^n
+	      Vector<double> tmp(dst.size());
+	      problem_space->vector_vector_transfer_interface_dofs(problem_space->linear_solution.block(1),dst,1,0,problem_space->Velocity);
+	      problem_space->vector_vector_transfer_interface_dofs(problem_space->linear_solution.block(0),tmp,0,0);
+	      dst-=tmp;
+	    }
+	} else {//adjoint 
+	  Vector<double> tmp(dst.size());
+	  if (problem_space->fem_properties.adjoint_type==1)
+	    {
+	      problem_space->vector_vector_transfer_interface_dofs(problem_space->adjoint_solution.block(1),dst,1,0,problem_space->Displacement);
+	    }
+	  else
+	    {
+	      problem_space->vector_vector_transfer_interface_dofs(problem_space->adjoint_solution.block(1),dst,1,0,problem_space->Velocity);
+	    }
+	  dst *= problem_space->fem_properties.structure_theta;
+	  dst.add(-problem_space->fem_properties.fluid_theta,problem_space->adjoint_solution.block(0));
+	}
+
+      };
+
+      bool transposed_adjoint() const {
+	return mode==problem_space->adjoint && problem_space->fem_properties.transposed_adjoint;
+      };
+
+      // Factors used for the current mode; adjoint solves in transposed mode back-substitute
+      // with the transpose of the linearized factors
+      std::vector<SparseDirectUMFPACK> & direct_solvers() const {
+	if (mode==problem_space->linear || transposed_adjoint()) return problem_space->linear_solver;
+	return problem_space->adjoint_solver;
+      };
+
+      BlockSparseMatrix<double> & operator_matrix() const {
+	if (mode==problem_space->linear || transposed_adjoint()) return problem_space->linear_matrix;
+	return problem_space->adjoint_matrix;
+      };
+
       FSIProblem<dim> *problem_space;
       unsigned int total_solves;
       bool matrix_assembled;
       bool matrix_initialized;
       enum FSIProblem<dim>::Mode mode;
       unsigned int initialized_timestep_number;
+      // Homogeneous Dirichlet dofs of the fluid and structure blocks, gathered when the operator is assembled
+      mutable std::vector<types::global_dof_index> fluid_boundary_dofs, structure_boundary_dofs;
+    };
+
+
+  // Upper block triangular preconditioner for the fluid saddle point matrix
+  //   [ A  -B^T ]
+  //   [ -B   0  ]
+  // (velocity dofs first). The velocity block is approximated by one AMG cycle
+  // (Trilinos) or an ILU of A, the Schur complement -B A^{-1} B^T by the scaled
+  // pressure mass matrix -M_p/(theta nu). The -B^T coupling is applied with the
+  // full fluid matrix, so only A and M_p are stored separately. Both approximations
+  // are owned by FSIProblem (see fluid_block_solve), the preconditioner only applies them.
+  template <int dim>
+    class FluidBlockPreconditioner
+    {
+    public:
+#ifdef DEAL_II_WITH_TRILINOS
+      typedef TrilinosWrappers::PreconditionAMG VelocityPreconditioner;
+#else
+      typedef SparseILU<double> VelocityPreconditioner;
+#endif
+
+    FluidBlockPreconditioner(FSIProblem<dim> *sim, const SparseMatrix<double> &fluid_matrix_):
+      fluid_matrix(fluid_matrix_),
+	n_u(sim->dofs_per_block[0]),
+	n_p(sim->dofs_per_block[1]),
+	schur_scaling(-sim->fem_properties.fluid_theta*sim->physical_properties.viscosity),
+	velocity_preconditioner(sim->fluid_velocity_preconditioner),
+	pressure_mass_solver(sim->fluid_pressure_mass_solver),
+	tmp(n_u+n_p),
+	tmp2(n_u+n_p),
+	velocity_rhs(n_u),
+	velocity_solution(n_u),
+	pressure_values(n_p)
+	{};
+
+      void vmult (Vector<double> &dst,
+		  const Vector<double> &src) const {
+	// pressure: y_p = S^{-1} r_p
+	for (unsigned int i=0; i<n_p; ++i)
+	  pressure_values(i) = src(n_u+i);
+	pressure_mass_solver.solve(pressure_values);
+	pressure_values *= schur_scaling;
+
+	// velocity: y_u = A^{-1} (r_u + B^T y_p), the coupling taken from the full matrix
+	tmp = 0;
+	for (unsigned int i=0; i<n_p; ++i)
+	  tmp(n_u+i) = pressure_values(i);
+	fluid_matrix.vmult(tmp2, tmp);
+	for (unsigned int i=0; i<n_u; ++i)
+	  velocity_rhs(i) = src(i) - tmp2(i);
+	velocity_preconditioner.vmult(velocity_solution, velocity_rhs);
+
+	for (unsigned int i=0; i<n_u; ++i)
+	  dst(i) = velocity_solution(i);
+	for (unsigned int i=0; i<n_p; ++i)
+	  dst(n_u+i) = pressure_values(i);
+      };
+
+    private:
+      const SparseMatrix<double> &fluid_matrix;
+      const unsigned int n_u, n_p;
+      const double schur_scaling;
+      const VelocityPreconditioner &velocity_preconditioner;
+      const SparseDirectUMFPACK &pressure_mass_solver;
+      mutable Vector<double> tmp, tmp2, velocity_rhs, velocity_solution, pressure_values;
+    };
+
+
+  // Block Gauss-Seidel preconditioner of the monolithic system, lower triangular in the order
+  // structure, fluid, ALE:
+  //   x_s = S^{-1} r_s,  x_f = F^{-1} (r_f - C_fs x_s),  x_a = A^{-1} (r_a - C_as x_s)
+  // with the direct factors of the diagonal blocks. The fluid rows added to the structure
+  // interface rows (the traction balance) are left out, which GMRES makes up for.
+  template <int dim>
+    class MonolithicPreconditioner
+    {
+    public:
+    MonolithicPreconditioner(FSIProblem<dim> *sim):
+      matrix(sim->system_matrix),
+	fluid_solver(sim->state_solver[0]),
+	structure_solver(sim->state_solver[1]),
+	ale_solver(sim->monolithic_ale_solver),
+	fluid_rhs(sim->dofs_per_big_block[0]),
+	ale_rhs(sim->dofs_per_big_block[2])
+	{};
+
+      void vmult (BlockVector<double> &dst,
+		  const BlockVector<double> &src) const {
+	structure_solver.vmult(dst.block(1), src.block(1));
+
+	matrix.block(0,1).vmult(fluid_rhs, dst.block(1));
+	fluid_rhs.sadd(-1., src.block(0));
+	fluid_solver.vmult(dst.block(0), fluid_rhs);
+
+	matrix.block(2,1).vmult(ale_rhs, dst.block(1));
+	ale_rhs.sadd(-1., src.block(2));
+	ale_solver.vmult(dst.block(2), ale_rhs);
+      };
+
+    private:
+      const BlockSparseMatrix<double> &matrix;
+      const SparseDirectUMFPACK &fluid_solver, &structure_solver, &ale_solver;
+      mutable Vector<double> fluid_rhs, ale_rhs;
     };
 
 
@@ -265,6 +430,338 @@ namespace LinearMap {
     };
 
 
+  // Krylov vector storing only the fluid interface velocity dofs, ordered as the
+  // source dofs of f2n. Inner products and norms are the interface_inner_product
+  // weighting, and a full fluid vector is only formed at the operator boundary.
+  template <int dim>
+    class InterfaceVector: public Vector<double>
+    {
+    public:
+    InterfaceVector(): Vector<double>(), problem_space(0) {};
+    InterfaceVector(FSIProblem<dim> *sim): Vector<double>(sim->f2n.size()), problem_space(sim) {};
+    InterfaceVector(const Vector<double> &src, FSIProblem<dim> *sim): Vector<double>(sim->f2n.size()), problem_space(sim) {
+	extract(src);
+      };
+    InterfaceVector(const InterfaceVector<dim> &v): Vector<double>(v), problem_space(v.problem_space) {};
+
+      using Vector<double>::reinit;
+      void reinit (const InterfaceVector<dim> &v, const bool omit_zeroing_entries = false) {
+	Vector<double>::reinit(v, omit_zeroing_entries);
+	problem_space = v.problem_space;
+      };
+
+      InterfaceVector<dim> & operator= (const InterfaceVector<dim> &v) {
+	Vector<double>::operator=(v);
+	problem_space = v.problem_space;
+	return *this;
+      };
+      InterfaceVector<dim> & operator= (const double s) {
+	Vector<double>::operator=(s);
+	return *this;
+      };
+
+      // Gather the interface entries of a full fluid vector
+      void extract (const Vector<double> &full) {
+	const std::vector<types::global_dof_index> &dofs = problem_space->f2n.from;
+	for (unsigned int k=0; k<dofs.size(); ++k)
+	  (*this)(k) = full(dofs[k]);
+      };
+      // Scatter into the interface entries of a full fluid vector
+      void distribute (Vector<double> &full) const {
+	const std::vector<types::global_dof_index> &dofs = problem_space->f2n.from;
+	for (unsigned int k=0; k<dofs.size(); ++k)
+	  full(dofs[k]) = (*this)(k);
+      };
+
+      double operator* (const InterfaceVector<dim> &v) const {
+	return problem_space->interface_mass_matrix.matrix_scalar_product(*this, v);
+      };
+      double norm_sqr () const {
+	return (*this)*(*this);
+      };
+      double l2_norm () const {
+	return std::sqrt(norm_sqr());
+      };
+      double add_and_dot (const double a, const InterfaceVector<dim> &x, const InterfaceVector<dim> &v) {
+	add(a, x);
+	return (*this)*v;
+      };
+
+    private:
+      FSIProblem<dim> *problem_space;
+    };
+
+
+  // Restarted GMRES for the interface operator with a recycled (deflation) subspace in the spirit
+  // of GCRO-DR. The space U spanned by approximate smallest right singular vectors of the operator
+  // on the last Krylov space survives between solves (outer iterations and time steps). At the start
+  // of a solve C = A U is recomputed for the current operator and orthonormalized, the residual is
+  // projected out of span(C) through U, and every Arnoldi vector is orthogonalized against C, so each
+  // cycle solves in span(U) + K((I - C C^T) A, r). Inner products are those of InterfaceVector.
+  template <int dim>
+    class RecyclingGMRES
+    {
+    public:
+    RecyclingGMRES(const unsigned int recycle_dimension_, const unsigned int restart_=53):
+      recycle_dimension(recycle_dimension_), restart(restart_) {};
+
+      void solve (const Linearized_Operator<dim> &A, InterfaceVector<dim> &x, const InterfaceVector<dim> &b,
+		  SolverControl &control) {
+	InterfaceVector<dim> r(x), w(x);
+	A.vmult(r, x);
+	r.sadd(-1., 1., b);
+	unsigned int step = 0;
+	SolverControl::State state = control.check(step, r.l2_norm());
+
+	// The operator has changed since the recycle space was built
+	C.resize(U.size());
+	for (unsigned int i=0; i<U.size(); ++i)
+	  A.vmult(C[i], U[i]);
+	orthonormalize();
+
+	while (state == SolverControl::iterate)
+	  {
+	    for (unsigned int i=0; i<C.size(); ++i)
+	      {
+		const double c = C[i]*r;
+		x.add(c, U[i]);
+		r.add(-c, C[i]);
+	      }
+	    const double beta = r.l2_norm();
+	    if (beta == 0)
+	      {
+		state = control.check(step, beta);
+		break;
+	      }
+
+	    std::vector<InterfaceVector<dim> > V(1, r);
+	    V[0] /= beta;
+	    FullMatrix<double> H(restart+1, restart), R(restart+1, restart), B(C.size(), restart);
+	    std::vector<double> g(restart+1, 0.), cs(restart, 0.), sn(restart, 0.);
+	    g[0] = beta;
+
+	    unsigned int j=0;
+	    while (j<restart && state == SolverControl::iterate)
+	      {
+		A.vmult(w, V[j]);
+		for (unsigned int i=0; i<C.size(); ++i)
+		  {
+		    B(i,j) = C[i]*w;
+		    w.add(-B(i,j), C[i]);
+		  }
+		for (unsigned int i=0; i<=j; ++i)
+		  {
+		    H(i,j) = V[i]*w;
+		    w.add(-H(i,j), V[i]);
+		  }
+		H(j+1,j) = w.l2_norm();
+		V.push_back(w);
+		if (H(j+1,j) != 0) V.back() /= H(j+1,j);
+
+		// Givens rotations on a copy of H track the residual of the small least squares problem
+		for (unsigned int i=0; i<=j+1; ++i)
+		  R(i,j) = H(i,j);
+		for (unsigned int i=0; i<j; ++i)
+		  {
+		    const double temp = cs[i]*R(i,j) + sn[i]*R(i+1,j);
+		    R(i+1,j) = -sn[i]*R(i,j) + cs[i]*R(i+1,j);
+		    R(i,j) = temp;
+		  }
+		const double d = std::sqrt(R(j,j)*R(j,j) + R(j+1,j)*R(j+1,j));
+		cs[j] = (d == 0) ? 1. : R(j,j)/d;
+		sn[j] = (d == 0) ? 0. : R(j+1,j)/d;
+		R(j,j) = d;
+		R(j+1,j) = 0;
+		g[j+1] = -sn[j]*g[j];
+		g[j] = cs[j]*g[j];
+		++j;
+		state = control.check(++step, std::fabs(g[j]));
+	      }
+
+	    // y minimizes |beta e_1 - H y|; the recycled coefficients are -B y since r is orthogonal to C
+	    Vector<double> y(j);
+	    for (int i=int(j)-1; i>=0; --i)
+	      {
+		y(i) = g[i];
+		for (unsigned int l=i+1; l<j; ++l)
+		  y(i) -= R(i,l)*y(l);
+		if (R(i,i) != 0) y(i) /= R(i,i);
+	      }
+	    for (unsigned int l=0; l<j; ++l)
+	      x.add(y(l), V[l]);
+	    for (unsigned int i=0; i<C.size(); ++i)
+	      {
+		double By = 0;
+		for (unsigned int l=0; l<j; ++l)
+		  By += B(i,l)*y(l);
+		x.add(-By, U[i]);
+	      }
+
+	    // r = V_{j+1} (beta e_1 - H y)
+	    r = 0;
+	    for (unsigned int i=0; i<=j; ++i)
+	      {
+		double t = (i==0) ? beta : 0.;
+		for (unsigned int l=0; l<j; ++l)
+		  t -= H(i,l)*y(l);
+		r.add(t, V[i]);
+	      }
+
+	    if (recycle_dimension > 0 && j > 0)
+	      update_recycle_space(V, H, B, j);
+	  }
+
+	AssertThrow(state == SolverControl::success, SolverControl::NoConvergence(control.last_step(), control.last_value()));
+      };
+
+      unsigned int n_recycled () const {
+	return U.size();
+      };
+
+    private:
+      // Orthonormalizes C, applying the same column operations to U so that A U = C still holds;
+      // dependent columns are dropped
+      void orthonormalize () {
+	std::vector<InterfaceVector<dim> > U_new, C_new;
+	for (unsigned int i=0; i<C.size(); ++i)
+	  {
+	    const double original_norm = C[i].l2_norm();
+	    for (unsigned int l=0; l<C_new.size(); ++l)
+	      {
+		const double h = C_new[l]*C[i];
+		C[i].add(-h, C_new[l]);
+		U[i].add(-h, U_new[l]);
+	      }
+	    const double norm = C[i].l2_norm();
+	    if (norm <= 1e-10*original_norm || norm == 0) continue;
+	    C[i] /= norm;
+	    U[i] /= norm;
+	    C_new.push_back(C[i]);
+	    U_new.push_back(U[i]);
+	  }
+	C.swap(C_new);
+	U.swap(U_new);
+      };
+
+      // With Y = [V_j U] and W = [C V_{j+1}] orthonormal, A Y = W G. Y is orthonormalized (the same
+      // column operations act on G) and the new U are the Y z for the eigenvectors z of G^T G with
+      // the smallest eigenvalues, i.e. approximate right singular vectors of A for its smallest
+      // singular values, with C = W G z.
+      void update_recycle_space (const std::vector<InterfaceVector<dim> > &V, const FullMatrix<double> &H,
+				 const FullMatrix<double> &B, const unsigned int j) {
+	const unsigned int k = C.size();
+	std::vector<InterfaceVector<dim> > Y(V.begin(), V.begin()+j);
+	std::vector<Vector<double> > G(j, Vector<double>(k+j+1));
+	for (unsigned int l=0; l<j; ++l)
+	  {
+	    for (unsigned int i=0; i<k; ++i)
+	      G[l](i) = B(i,l);
+	    for (unsigned int i=0; i<=j; ++i)
+	      G[l](k+i) = H(i,l);
+	  }
+	for (unsigned int i=0; i<k; ++i)
+	  {
+	    InterfaceVector<dim> u(U[i]);
+	    Vector<double> g(k+j+1);
+	    g(i) = 1;
+	    const double original_norm = u.l2_norm();
+	    for (unsigned int l=0; l<Y.size(); ++l)
+	      {
+		const double h = Y[l]*u;
+		u.add(-h, Y[l]);
+		g.add(-h, G[l]);
+	      }
+	    const double norm = u.l2_norm();
+	    if (norm <= 1e-10*original_norm || norm == 0) continue;
+	    u /= norm;
+	    g /= norm;
+	    Y.push_back(u);
+	    G.push_back(g);
+	  }
+
+	const unsigned int n = Y.size();
+	FullMatrix<double> GtG(n,n), Z(n,n);
+	for (unsigned int a=0; a<n; ++a)
+	  for (unsigned int b=0; b<n; ++b)
+	    GtG(a,b) = G[a]*G[b];
+	symmetric_eigenpairs(GtG, Z);
+
+	std::vector<std::pair<double,unsigned int> > order(n);
+	for (unsigned int a=0; a<n; ++a)
+	  order[a] = std::make_pair(GtG(a,a), a);
+	std::sort(order.begin(), order.end());
+
+	const unsigned int k_new = std::min(recycle_dimension, n);
+	std::vector<InterfaceVector<dim> > U_new(k_new, Y[0]), C_new(k_new, Y[0]);
+	for (unsigned int i=0; i<k_new; ++i)
+	  {
+	    const unsigned int column = order[i].second;
+	    U_new[i] = 0;
+	    Vector<double> Gz(k+j+1);
+	    for (unsigned int a=0; a<n; ++a)
+	      {
+		U_new[i].add(Z(a,column), Y[a]);
+		Gz.add(Z(a,column), G[a]);
+	      }
+	    C_new[i] = 0;
+	    for (unsigned int l=0; l<k; ++l)
+	      C_new[i].add(Gz(l), C[l]);
+	    for (unsigned int l=0; l<=j; ++l)
+	      C_new[i].add(Gz(k+l), V[l]);
+	  }
+	U.swap(U_new);
+	C.swap(C_new);
+	orthonormalize();
+      };
+
+      // Cyclic Jacobi iteration for a small symmetric matrix: a is overwritten by its
+      // diagonalization, the columns of z are the eigenvectors
+      static void symmetric_eigenpairs (FullMatrix<double> &a, FullMatrix<double> &z) {
+	const unsigned int n = a.m();
+	z = IdentityMatrix(n);
+	const double norm = a.frobenius_norm();
+	for (unsigned int sweep=0; sweep<100; ++sweep)
+	  {
+	    double off = 0;
+	    for (unsigned int p=0; p<n; ++p)
+	      for (unsigned int q=p+1; q<n; ++q)
+		off += a(p,q)*a(p,q);
+	    if (std::sqrt(off) <= 1e-14*norm) break;
+	    for (unsigned int p=0; p<n; ++p)
+	      for (unsigned int q=p+1; q<n; ++q)
+		{
+		  if (a(p,q) == 0) continue;
+		  const double theta = (a(q,q) - a(p,p))/(2*a(p,q));
+		  const double t = ((theta >= 0) ? 1. : -1.)/(std::fabs(theta) + std::sqrt(theta*theta + 1));
+		  const double c = 1./std::sqrt(t*t + 1), s = t*c;
+		  for (unsigned int l=0; l<n; ++l)
+		    {
+		      const double alp = a(l,p), alq = a(l,q);
+		      a(l,p) = c*alp - s*alq;
+		      a(l,q) = s*alp + c*alq;
+		    }
+		  for (unsigned int l=0; l<n; ++l)
+		    {
+		      const double apl = a(p,l), aql = a(q,l);
+		      a(p,l) = c*apl - s*aql;
+		      a(q,l) = s*apl + c*aql;
+		    }
+		  for (unsigned int l=0; l<n; ++l)
+		    {
+		      const double zlp = z(l,p), zlq = z(l,q);
+		      z(l,p) = c*zlp - s*zlq;
+		      z(l,q) = s*zlp + c*zlq;
+		    }
+		}
+	  }
+      };
+
+      const unsigned int recycle_dimension;
+      const unsigned int restart;
+      std::vector<InterfaceVector<dim> > U, C;
+    };
+
+
   /* class Vector//: public Vector<double> */
   /* { */
   /*  public: */
@@ -0,0 +1,209 @@
+#include "FSI_Project.h"
+#include <deal.II/lac/compressed_simple_sparsity_pattern.h>
+#include <deal.II/lac/solver_control.h>
+#include <deal.II/lac/solver_gmres.h>
+#include "linear_maps.h"
+
+// The monolithic system keeps the three subproblems in their blocks and couples them on the interface:
+// (0,1) the fluid interface velocity rows become u_f - v_s = 0,
+// (1,0) the fluid momentum rows of the interface dofs are added to the structure displacement rows
+//       of the same test function, so the fluid traction enters as the residual of the fluid equation,
+// (2,1) the ALE interface rows become a - d_s = 0.
+// setup_system has no interface maps yet, so the coupling entries are added to its pattern afterwards
+template <int dim>
+void FSIProblem<dim>::setup_monolithic_sparsity ()
+{
+  BlockCompressedSimpleSparsityPattern csp (n_big_blocks,n_big_blocks);
+  for (unsigned int i=0; i<n_big_blocks; ++i)
+    for (unsigned int j=0; j<n_big_blocks; ++j)
+      csp.block(i,j).reinit (dofs_per_big_block[i], dofs_per_big_block[j]);
+  csp.collect_sizes();
+
+  for (unsigned int b=0; b<n_big_blocks; ++b)
+    {
+      const SparsityPattern &block_pattern = sparsity_pattern.block(b,b);
+      for (unsigned int row=0; row<dofs_per_big_block[b]; ++row)
+	for (SparsityPattern::iterator it=block_pattern.begin(row); it!=block_pattern.end(row); ++it)
+	  csp.block(b,b).add(row, it->column());
+    }
+
+  for (unsigned int k=0; k<f2v.size(); ++k)
+    csp.block(0,1).add(f2v.from[k], f2v.to[k]);
+  const SparsityPattern &fluid_pattern = sparsity_pattern.block(0,0);
+  for (unsigned int k=0; k<f2n.size(); ++k)
+    for (SparsityPattern::iterator it=fluid_pattern.begin(f2n.from[k]); it!=fluid_pattern.end(f2n.from[k]); ++it)
+      csp.block(1,0).add(f2n.to[k], it->column());
+  for (unsigned int k=0; k<a2n.size(); ++k)
+    csp.block(2,1).add(a2n.from[k], a2n.to[k]);
+
+  // The matrices hold on to the blocks of the old pattern
+  system_matrix.clear();
+  adjoint_matrix.clear();
+  linear_matrix.clear();
+  sparsity_pattern.copy_from (csp);
+  system_matrix.reinit (sparsity_pattern);
+  if (!fem_properties.transposed_adjoint) adjoint_matrix.reinit (sparsity_pattern);
+  linear_matrix.reinit (sparsity_pattern);
+}
+
+// Moves the fluid mesh to the ALE displacement of the current iterate
+template <int dim>
+void FSIProblem<dim>::update_fluid_geometry ()
+{
+  transfer_all_dofs(solution,mesh_displacement_star,2,0);
+  mesh_displacement_star.block(2) = solution.block(2); // Euler vector of the fluid mapping
+  mesh_displacement_star_old.block(0) = mesh_displacement_star.block(0);
+
+  if (fem_properties.time_dependent) {
+    mesh_velocity.block(0)=mesh_displacement_star.block(0);
+    mesh_velocity.block(0)-=old_mesh_displacement.block(0);
+    mesh_velocity.block(0)*=1./time_step;
+  }
+}
+
+// Newton iteration on the coupled fluid, structure and ALE system. As in fluid_state_solve the first
+// pass is a Picard step and every pass solves for the new iterate. The derivatives with respect to
+// the fluid geometry are not assembled: the mesh follows the ALE block of the previous iterate.
+template <int dim>
+void FSIProblem<dim>::monolithic_state_solve ()
+{
+  AssertThrow(physical_properties.simulation_type!=2, ExcNotImplemented());
+  // The fluid rows enter the structure rows unscaled: the fluid traction is weighted by fluid_theta,
+  // the structure one by structure_theta times the surface Jacobian, which is only one for linear elasticity
+  AssertThrow(fem_properties.fluid_theta==fem_properties.structure_theta,
+	      ExcMessage("The monolithic solve needs equal fluid and structure theta."));
+  AssertThrow(!physical_properties.nonlinear_elasticity,
+	      ExcMessage("The monolithic solve needs a unit surface Jacobian (linear elasticity)."));
+
+  // The traction is part of the system, so the interface loads of the partitioned
+  // formulations are not used
+  stress = 0;
+  old_stress = 0;
+
+  std::map<types::global_dof_index,double> fluid_boundary_values, structure_boundary_values, ale_boundary_values;
+  fluid_state_boundary_values(fluid_boundary_values);
+  structure_state_boundary_values(structure_boundary_values);
+  ale_state_boundary_values(ale_boundary_values);
+
+  // ALE rows: the vector Laplacian with the boundary rows reduced to their diagonal,
+  // the interface ones tied to the structure displacement
+  if (ale_matrix_unconstrained.empty())
+    {
+      assemble_ale(state,true);
+      ale_matrix_unconstrained.reinit(sparsity_pattern.block(2,2));
+      ale_matrix_unconstrained.copy_from(system_matrix.block(2,2));
+    }
+  system_matrix.block(2,2).copy_from(ale_matrix_unconstrained);
+  system_matrix.block(2,1) = 0;
+  system_rhs.block(2) = 0;
+  for (std::map<types::global_dof_index,double>::const_iterator it=ale_boundary_values.begin(); it!=ale_boundary_values.end(); ++it)
+    {
+      for (SparseMatrix<double>::iterator entry=system_matrix.block(2,2).begin(it->first); entry!=system_matrix.block(2,2).end(it->first); ++entry)
+	if (entry->column()!=it->first) entry->value() = 0;
+      system_rhs.block(2)(it->first) = system_matrix.block(2,2).diag_element(it->first)*it->second;
+    }
+  for (unsigned int k=0; k<a2n.size(); ++k)
+    {
+      const double diagonal = system_matrix.block(2,2).diag_element(a2n.from[k]);
+      std::map<types::global_dof_index,double>::const_iterator fixed = structure_boundary_values.find(a2n.to[k]);
+      if (fixed==structure_boundary_values.end())
+	{
+	  system_matrix.block(2,1).set(a2n.from[k], a2n.to[k], -diagonal);
+	  system_rhs.block(2)(a2n.from[k]) = 0;
+	}
+      else
+	{
+	  system_rhs.block(2)(a2n.from[k]) = diagonal*fixed->second;
+	}
+    }
+  if (!monolithic_ale_factored)
+    {
+      monolithic_ale_solver.initialize(system_matrix.block(2,2));
+      monolithic_ale_factored = true;
+    }
+
+  bool newton = fem_properties.fluid_newton;
+  unsigned int picard_iterations = 1;
+  unsigned int loop_count = 0;
+  double update_norm = 0;
+  do {
+    solution_star = solution;
+    if (physical_properties.moving_domain) update_fluid_geometry();
+
+    if (loop_count < picard_iterations) fem_properties.fluid_newton = false;
+    Threads::Task<> f_assembly = Threads::new_task(&FSIProblem<dim>::assemble_fluid, *this, state, true);
+    Threads::Task<> s_assembly = Threads::new_task(&FSIProblem<dim>::assemble_structure, *this, state, true);
+    f_assembly.join();
+    s_assembly.join();
+    if (loop_count < picard_iterations) fem_properties.fluid_newton = newton;
+
+    MatrixTools::apply_boundary_values (fluid_boundary_values,
+					system_matrix.block(0,0),
+					solution.block(0),
+					system_rhs.block(0));
+    MatrixTools::apply_boundary_values (structure_boundary_values,
+					system_matrix.block(1,1),
+					solution.block(1),
+					system_rhs.block(1));
+
+    // Traction balance: the structure interface rows get the fluid rows of the same test function
+    system_matrix.block(1,0) = 0;
+    const SparseMatrix<double> &fluid_matrix = system_matrix.block(0,0);
+    for (unsigned int k=0; k<f2n.size(); ++k)
+      {
+	if (fluid_boundary_values.find(f2n.from[k])!=fluid_boundary_values.end()
+	    || structure_boundary_values.find(f2n.to[k])!=structure_boundary_values.end()) continue;
+	for (SparseMatrix<double>::const_iterator it=fluid_matrix.begin(f2n.from[k]); it!=fluid_matrix.end(f2n.from[k]); ++it)
+	  system_matrix.block(1,0).add(f2n.to[k], it->column(), it->value());
+	system_rhs.block(1)(f2n.to[k]) += system_rhs.block(0)(f2n.from[k]);
+      }
+
+    // Velocity continuity replaces the fluid interface rows; Dirichlet sides take precedence
+    system_matrix.block(0,1) = 0;
+    for (unsigned int k=0; k<f2v.size(); ++k)
+      {
+	if (fluid_boundary_values.find(f2v.from[k])!=fluid_boundary_values.end()) continue;
+	for (SparseMatrix<double>::iterator it=system_matrix.block(0,0).begin(f2v.from[k]); it!=system_matrix.block(0,0).end(f2v.from[k]); ++it)
+	  if (it->column()!=f2v.from[k]) it->value() = 0;
+	const double diagonal = system_matrix.block(0,0).diag_element(f2v.from[k]);
+	std::map<types::global_dof_index,double>::const_iterator fixed = structure_boundary_values.find(f2v.to[k]);
+	if (fixed==structure_boundary_values.end())
+	  {
+	    system_matrix.block(0,1).set(f2v.from[k], f2v.to[k], -diagonal);
+	    system_rhs.block(0)(f2v.from[k]) = 0;
+	  }
+	else
+	  {
+	    system_rhs.block(0)(f2v.from[k]) = diagonal*fixed->second;
+	  }
+      }
+
+    state_solver[0].factorize(system_matrix.block(0,0));
+    state_solver[1].factorize(system_matrix.block(1,1));
+    LinearMap::MonolithicPreconditioner<dim> preconditioner(this);
+
+    SolverControl solver_control(1000, fem_properties.monolithic_linear_tolerance*system_rhs.l2_norm());
+    SolverGMRES<BlockVector<double> > solver (solver_control, SolverGMRES<BlockVector<double> >::AdditionalData(50, true));
+    solver.solve(system_matrix, solution, system_rhs, preconditioner);
+
+    fluid_constraints.distribute (solution.block(0));
+    structure_constraints.distribute (solution.block(1));
+    ale_constraints.distribute (solution.block(2));
+
+    solution_star -= solution;
+    update_norm = solution_star.l2_norm();
+    std::cout << "M: " << update_norm << " (GMRES steps: " << solver_control.last_step() << ")" << std::endl;
+    ++loop_count;
+  } while (update_norm>1e-8 && loop_count<fem_properties.max_optimization_iterations);
+  solution_star = solution;
+
+  if (physical_properties.moving_domain)
+    {
+      update_fluid_geometry();
+      assemble_interface_mass_matrix();
+    }
+}
+
+template void FSIProblem<2>::setup_monolithic_sparsity ();
+template void FSIProblem<2>::update_fluid_geometry ();
+template void FSIProblem<2>::monolithic_state_solve ();
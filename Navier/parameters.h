@@ -59,11 +59,30 @@ namespace Parameters
     bool                true_control;
     std::string 	optimization_method;
     unsigned int        adjoint_type;
+    bool                transposed_adjoint;
+    bool                colored_assembly;
+    std::string         fluid_linear_solver;
+    double              fluid_linear_tolerance;
+    std::string         ale_solver;
+    double              ale_solver_tolerance;
+    std::string         coupling_acceleration;
+    unsigned int        coupling_reuse_steps;
+    unsigned int        anderson_depth;
+    unsigned int        recycle_dimension;
+    unsigned int        predictor_order;
+    std::string         forcing_term;
+    double              forcing_gamma;
+    double              forcing_alpha;
+    double              forcing_max;
+    bool                linearized_line_search;
+    double              monolithic_linear_tolerance;
 
     // Solver Parameters
     bool                  richardson;
     bool                  fluid_newton; 
     bool                  structure_newton; 
+    bool                  modified_newton;
+    double                jacobian_refresh_ratio;
   };
   struct PhysicalProperties
   {
@@ -77,6 +96,7 @@ namespace Parameters
     double 		rho_s;
     bool		moving_domain;
     bool                move_domain;
+    bool                eulerian_mapping;
     int			n_fourier_coeffs;
     bool                navier_stokes;
     bool                stability_terms;
@@ -179,10 +199,44 @@ namespace Parameters
 			    "maximum number of optimization iterations per time step.");
 	  prm.declare_entry("true control","false", Patterns::Bool(),
 			    "Use the true stress as the initial control at each time step.");
-	  prm.declare_entry("optimization method","CG", Patterns::Selection("CG|BICG|DN|Gradient|GMRES"),
-			    "optimization method choices {CG,BICG,GMRES,Gradient,DN}.");
+	  prm.declare_entry("optimization method","CG", Patterns::Selection("CG|BICG|DN|Gradient|GMRES|Monolithic"),
+			    "optimization method choices {CG,BICG,GMRES,Gradient,DN,Monolithic}.");
 	  prm.declare_entry("adjoint type","1", Patterns::Integer(1),
 			    "adjoint displacement (1) or velocity (2) used in objective function.");
+	  prm.declare_entry("transposed adjoint","false", Patterns::Bool(),
+			    "solve the adjoint systems with the transposed factorization of the linearized systems instead of assembling them (deal.II 8.3 or later, stability terms on moving domains).");
+	  prm.declare_entry("colored assembly","false", Patterns::Bool(),
+			    "assemble cells of one color concurrently, writing directly into the global matrices.");
+	  prm.declare_entry("fluid linear solver","direct", Patterns::Selection("direct|gmres"),
+			    "fluid state linear solver choices {direct (UMFPACK), gmres (block triangular preconditioner)}.");
+	  prm.declare_entry("fluid linear tolerance","1e-10", Patterns::Double(0),
+			    "relative residual tolerance of the iterative fluid linear solver.");
+	  prm.declare_entry("ale solver","direct", Patterns::Selection("direct|cg"),
+			    "ALE linear solver choices {direct (UMFPACK), cg (AMG or SSOR preconditioned)}.");
+	  prm.declare_entry("ale solver tolerance","1e-12", Patterns::Double(0),
+			    "relative residual tolerance of the iterative ALE solver.");
+	  prm.declare_entry("coupling acceleration","constant", Patterns::Selection("constant|Aitken|IQN-ILS|Anderson"),
+			    "update of the interface displacement in the DN iteration {constant (relaxation by steepest descent alpha), Aitken (dynamic relaxation), IQN-ILS (interface quasi-Newton), Anderson (mixing by steepest descent alpha)}.");
+	  prm.declare_entry("coupling reuse steps","0", Patterns::Integer(0),
+			    "number of previous time steps whose IQN-ILS or Anderson secant information is reused.");
+	  prm.declare_entry("anderson depth","5", Patterns::Integer(1),
+			    "number of previous DN iterates used by Anderson acceleration.");
+	  prm.declare_entry("recycle dimension","0", Patterns::Integer(0),
+			    "number of vectors the interface GMRES recycles between solves (0 for plain restarted GMRES).");
+	  prm.declare_entry("predictor order","0", Patterns::Integer(0,2),
+			    "order of the extrapolation in time of the control and the initial iterates of each time step (0 keeps the last step).");
+	  prm.declare_entry("forcing term","constant", Patterns::Selection("constant|EW1|EW2"),
+			    "tolerance of the interface GMRES {constant (cg tolerance), EW1, EW2 (Eisenstat-Walker choices 1 and 2)}.");
+	  prm.declare_entry("forcing gamma","0.9", Patterns::Double(0,1),
+			    "gamma of the Eisenstat-Walker choice 2 forcing term.");
+	  prm.declare_entry("forcing alpha","2", Patterns::Double(1,2),
+			    "alpha of the Eisenstat-Walker choice 2 forcing term.");
+	  prm.declare_entry("forcing max","0.9", Patterns::Double(0,1),
+			    "upper bound of the Eisenstat-Walker forcing terms, also used for the first outer iteration.");
+	  prm.declare_entry("linearized line search","false", Patterns::Bool(),
+			    "pick the line search step on a model of the interface jump from the Krylov or adjoint solve; the next state solve confirms it and the nonlinear backtracking only runs when it fails.");
+	  prm.declare_entry("monolithic linear tolerance","1e-8", Patterns::Double(0),
+			    "relative residual tolerance of the GMRES solves of the monolithic Newton iterations.");
 
 	  // Operations Parameters
 	  prm.declare_entry("richardson", "true", Patterns::Bool(),
@@ -191,10 +245,16 @@ namespace Parameters
 			    "use Newton's method for convergence of nonlinearity in NS solve.");
 	  prm.declare_entry("structure newton", "true", Patterns::Bool(),
 			    "use Newton's method for convergence of nonlinearity in Elasticity solve.");
+	  prm.declare_entry("modified newton", "false", Patterns::Bool(),
+			    "keep the factorizations of the fluid and structure state matrices (for the gmres fluid solver its velocity preconditioner) across iterations and time steps until the iteration contracts too slowly.");
+	  prm.declare_entry("jacobian refresh ratio", "0.5", Patterns::Double(0,1),
+			    "refactor the lagged matrix when an update norm exceeds this fraction of the previous one.");
 	  prm.declare_entry("moving domain", "true", Patterns::Bool(),
 	  			  "should the ALE be used.");
 	  prm.declare_entry("move domain", "false", Patterns::Bool(),
 	  			  "should the points be physically moved (vs using determinants).");
+	  prm.declare_entry("eulerian mapping", "false", Patterns::Bool(),
+	  			  "see the moved fluid domain through a MappingQEulerian on the ALE displacement instead of moving vertices.");
 
   }
 }
@@ -6,6 +6,35 @@
 #include <deal.II/lac/solver_cg.h>
 #include "linear_maps.h"
 
+// Backtracking on a model of interface_error() along the control stress_star + alpha step. The jump
+// part is 0.5|jump|^2 ~ j_0 + alpha jump_slope + 0.5 alpha^2 jump_curvature, with coefficients taken
+// from the solve that produced the step, and the penalty part is evaluated exactly, so a trial
+// needs no state, linearized or adjoint solve. Returns the first alpha the model accepts, or 0
+// if it rejects all of them.
+template <int dim>
+double FSIProblem<dim>::linearized_line_search (const Vector<double> &step, const double jump_slope, const double jump_curvature,
+						const double alpha_0, const double objective, const double t_val)
+{
+  Vector<double> no_jump(step.size()), control(stress_star.block(0));
+  const double jump_objective = objective - interface_functional(no_jump, control);
+  double alpha = alpha_0;
+  for (unsigned int trial=0; trial<30; ++trial)
+    {
+      control = stress_star.block(0);
+      control.add(alpha, step);
+      const double model_objective = std::max(0., jump_objective + alpha*jump_slope + 0.5*alpha*alpha*jump_curvature)
+	+ interface_functional(no_jump, control);
+      if (objective - model_objective >= std::abs(alpha)*t_val)
+	{
+	  std::cout << "Linearized line search alpha: " << alpha << std::endl;
+	  return alpha;
+	}
+      alpha *= .5;
+    }
+  std::cout << "Linearized line search failed" << std::endl;
+  return 0;
+}
+
 template <int dim>
 void FSIProblem<dim>::run ()
 {
@@ -40,6 +69,8 @@ void FSIProblem<dim>::run ()
   // Threads::Task<void>
   //  task = Threads::new_task (&FSIProblem<dim>::build_dof_mapping,*this);
   build_dof_mapping();
+  const bool monolithic = fem_properties.optimization_method.compare("Monolithic")==0;
+  if (monolithic) setup_monolithic_sparsity();
 
   timer.leave_subsection();
 
@@ -113,11 +144,7 @@ void FSIProblem<dim>::run ()
 	else
 	  {
 	    solution.block(1)=old_solution.block(1); // solutions sets boundary values for Laplace solve
-	    assemble_ale(state,true);
-	    dirichlet_boundaries((System)2,state);
-	    state_solver[2].factorize(system_matrix.block(2,2));
-	    solve(state_solver[2],2,state);
-	    transfer_all_dofs(solution,mesh_displacement_star,2,0);
+	    ale_state_solve();
 	  }
       } else {
 	const std::string mesh_filename = "mesh.data";
@@ -126,6 +153,7 @@ void FSIProblem<dim>::run ()
 	mesh_input.close();
       }
     }
+  assemble_interface_mass_matrix();
 
   Vector<double> lift(total_timesteps);
   Vector<double> drag(total_timesteps);
@@ -167,12 +195,22 @@ void FSIProblem<dim>::run ()
   // *****************************************************************************************
   double total_time = 0;
   const unsigned int initialized_timestep_number = timestep_number;
+  // Keeps its deflation space from one interface solve to the next, across time steps
+  LinearMap::RecyclingGMRES<dim> recycling_gmres(fem_properties.recycle_dimension);
+  // Accepted controls and solutions of the last time steps, for the predictor
+  StepHistory stress_history, solution_history;
+  stress_history.push(stress);
+  solution_history.push(solution);
   // timestep_number = 1 by default, is something else if given as 2nd command line argument to FSI_Project
   for (; timestep_number<=total_timesteps; ++timestep_number)
     {
-      double n_max = 0;
-      double tau_t = 0;
+      // Inexact Newton forcing term of the interface GMRES and the residual history it is computed from
+      double forcing = fem_properties.forcing_max;
+      double previous_residual_norm = 0;
+      double previous_linear_residual = 0;
       bool AG_line_search = false;
+      // set when the linearized line search accepted the step without a nonlinear trial
+      bool model_step = false;
 
       if (!fem_properties.time_dependent) {
 	timestep_number=total_timesteps;
@@ -191,6 +229,7 @@ void FSIProblem<dim>::run ()
       //unsigned int total_relrecord=0;
 
       unsigned int count = 0;
+      coupling_accelerator.new_time_step();
 
       rhs_for_adjoint=1;
 
@@ -211,6 +250,17 @@ void FSIProblem<dim>::run ()
   	  old_mesh_displacement.block(0) = mesh_displacement_star.block(0);
   	}
 
+      // Predict the control and the fluid and structure iterates from the last accepted steps
+      if (fem_properties.predictor_order > 0 && fem_properties.time_dependent)
+	{
+	  stress_history.extrapolate(fem_properties.predictor_order, stress);
+	  stress_star = stress;
+	  BlockVector<double> predicted_solution(solution);
+	  solution_history.extrapolate(fem_properties.predictor_order, predicted_solution);
+	  solution.block(0) = predicted_solution.block(0);
+	  solution.block(1) = predicted_solution.block(1);
+	}
+
       BlockVector<double> update_direction = stress;
       double alpha_j = 1.0;
       double t_val = 0;
@@ -220,13 +270,13 @@ void FSIProblem<dim>::run ()
       // *****************************************************************************************
       while (true)
         {
-	  double n_val = n_max;
 	  double m_val = 0;
 
-	  if (!AG_line_search) alpha_j = 1.0;
+	  if (!AG_line_search && !model_step) alpha_j = 1.0;
 
-	  if (AG_line_search) {
-	    std::cout << "Line search. " << std::endl;
+	  if (AG_line_search || model_step) {
+	    if (model_step) ++count;
+	    else std::cout << "Line search. " << std::endl;
 	    stress *= 0;
 	    transfer_interface_dofs(stress_star, stress, 0, 0);
 	    
@@ -244,11 +294,7 @@ void FSIProblem<dim>::run ()
 
 	    if (physical_properties.moving_domain)
 	      {
-		assemble_ale(state,true);
-		dirichlet_boundaries((System)2,state);
-		state_solver[2].factorize(system_matrix.block(2,2));
-		solve(state_solver[2],2,state);
-		transfer_all_dofs(solution,mesh_displacement_star,2,0);
+		ale_state_solve();
 
 		if (physical_properties.simulation_type==2)
 		  {
@@ -266,6 +312,7 @@ void FSIProblem<dim>::run ()
 		  mesh_velocity.block(0)-=old_mesh_displacement.block(0);
 		  mesh_velocity.block(0)*=1./time_step;
 		}
+		assemble_interface_mass_matrix();
 	      }
 
 	  } else {
@@ -283,13 +330,10 @@ void FSIProblem<dim>::run ()
 	    // RHS and Neumann conditions are inside these functions
 	    // Solve for the state variables
 	    timer.enter_subsection ("Assemble"); 
-	    if (physical_properties.moving_domain)
+	    // The monolithic solve moves the mesh itself
+	    if (physical_properties.moving_domain && !monolithic)
 	      {
-		assemble_ale(state,true);
-		dirichlet_boundaries((System)2,state);
-		state_solver[2].factorize(system_matrix.block(2,2));
-		solve(state_solver[2],2,state);
-		transfer_all_dofs(solution,mesh_displacement_star,2,0);
+		ale_state_solve();
 
 		if (physical_properties.simulation_type==2)
 		  {
@@ -307,6 +351,7 @@ void FSIProblem<dim>::run ()
 		  mesh_velocity.block(0)-=old_mesh_displacement.block(0);
 		  mesh_velocity.block(0)*=1./time_step;
 		}
+		assemble_interface_mass_matrix();
 	      }
 
 	    // Threads::Task<> s_assembly = Threads::new_task(&FSIProblem<dim>::assemble_structure,*this,state,true);
@@ -344,6 +389,10 @@ void FSIProblem<dim>::run ()
 	    ref_transform_fluid();
 	    transfer_interface_dofs(tmp,stress,0,1,Displacement);
 	    structure_state_solve(initialized_timestep_number);
+	    // Relaxed or quasi-Newton update of the interface displacement seen by the next fluid solve
+	    update_coupling_iterate(structure_previous_iterate);
+	  } else if (monolithic) {
+	    monolithic_state_solve();
 	  } else {
 	    // Solve both fluid and structure simultaneously
 	    Threads::Task<> s_solver = Threads::new_task(&FSIProblem<dim>::structure_state_solve,*this, initialized_timestep_number);
@@ -376,8 +425,6 @@ void FSIProblem<dim>::run ()
 	    // *****************************************************************************************
 	    velocity_jump_old = velocity_jump;
 
-	    if (count==1) tau_t = fem_properties.cg_tolerance * std::sqrt(velocity_jump);
-
 	    if (fem_properties.optimization_method.compare("DN")!=0) {
 	      velocity_jump=interface_error();
 	    } else {
@@ -386,8 +433,25 @@ void FSIProblem<dim>::run ()
 	      velocity_jump=interface_error();
 	    } 
 	    if (count%1==0) pcout << "Jump Error: " << velocity_jump << std::endl;
-	    if (count >= fem_properties.max_optimization_iterations || velocity_jump < fem_properties.jump_tolerance) break;
-  	  
+	    // The monolithic solve has no outer iteration, its interface error is only reported
+	    if (count >= fem_properties.max_optimization_iterations || velocity_jump < fem_properties.jump_tolerance || monolithic) break;
+
+	    // Check the step the linearized line search took without a nonlinear trial; if the jump did not
+	    // decrease enough, fall back to the nonlinear backtracking from half of it
+	    if (model_step)
+	      {
+		model_step = false;
+		if ((velocity_jump_old - velocity_jump) < std::abs(alpha_j) * t_val)
+		  {
+		    std::cout << "Linearized step rejected, jump: " << velocity_jump << std::endl;
+		    velocity_jump = velocity_jump_old;
+		    alpha_j *= .5;
+		    AG_line_search = true;
+		    continue;
+		  }
+	      }
+
+	    double model_alpha = 0;
 	    if (fem_properties.optimization_method.compare("Gradient")==0)
 	      {
 		stress_star = stress;
@@ -447,6 +511,17 @@ void FSIProblem<dim>::run ()
 		//x *= -1;
 		AG_line_search = true;
 		alpha_j = fem_properties.steepest_descent_alpha;
+		if (fem_properties.linearized_line_search)
+		  {
+		    // stress_star + alpha_j (update_direction/epsilon - stress_star) is the trial control. The adjoint
+		    // output x is minus the jump derivative applied to the jump, so the jump part has slope -(x,step);
+		    // its curvature would need a linearized solve and is left out
+		    Vector<double> step(update_direction.block(0));
+		    step *= 1./fem_properties.penalty_epsilon;
+		    step.add(-1., stress_star.block(0));
+		    model_alpha = linearized_line_search(step, -interface_inner_product(update_direction.block(0), step), 0.,
+							 alpha_j, velocity_jump, t_val);
+		  }
 
 		// // Update the stress using the adjoint variables
 		// stress.block(0)*=(1-alpha);
@@ -466,9 +541,9 @@ void FSIProblem<dim>::run ()
 	    else if (fem_properties.optimization_method.compare("CG")==0) 
 	      {
 		LinearMap::Linearized_Operator<dim> A(this);
-		LinearMap::NeumannVector<dim> output_vector(rhs_for_adjoint.block(0), this);
+		LinearMap::InterfaceVector<dim> output_vector(rhs_for_adjoint.block(0), this);
 		for (Vector<double>::iterator it=output_vector.begin(); it!=output_vector.end(); ++it) *it = std::max(physical_properties.rho_f,physical_properties.rho_s) * rhs_for_adjoint.block(0).l2_norm()*1e10;
-		LinearMap::NeumannVector<dim> input_vector(rhs_for_adjoint.block(0), this);
+		LinearMap::InterfaceVector<dim> input_vector(rhs_for_adjoint.block(0), this);
 		//input_vector *= -1;
 		//A.vmult(output_vector, input_vector);
 		//tmp.block(0).add(-1.0, output_vector);
@@ -477,9 +552,9 @@ void FSIProblem<dim>::run ()
 		//ReductionControl solver_control(1000, 1e-50, fem_properties.cg_tolerance, false, false);
 		SolverControl solver_control(1000, 1e-50, false, false);
 		//GrowingVectorMemory<Vector<double> > mem;
-		PrimitiveVectorMemory<Vector<double> > mem;
-		SolverCG<Vector<double> > solver (solver_control);//, mem, SolverCG<Vector<double> >::AdditionalData(false /*exact residual */, -1.e-250 /* breakdown */));
-		A.initialize_matrix(output_vector, input_vector, linear, initialized_timestep_number);
+		PrimitiveVectorMemory<LinearMap::InterfaceVector<dim> > mem;
+		SolverCG<LinearMap::InterfaceVector<dim> > solver (solver_control, mem);//, SolverCG<Vector<double> >::AdditionalData(false /*exact residual */, -1.e-250 /* breakdown */));
+		A.initialize_matrix(tmp.block(0), rhs_for_adjoint.block(0), linear, initialized_timestep_number);
 		try {
 		  solver.solve(A, output_vector, input_vector, PreconditionIdentity());
 		} catch (std::exception &e) {
@@ -489,7 +564,9 @@ void FSIProblem<dim>::run ()
 		std::cout << "last val: " << solver_control.last_value() << std::endl;
 		std::cout << "last step:" << solver_control.last_step() << std::endl;
 		//std::cout << input_vector << std::endl; 
-		stress.block(0).add(1.0, output_vector);
+		update_direction.block(0) = 0;
+		output_vector.distribute(update_direction.block(0));
+		stress.block(0).add(1.0, update_direction.block(0));
 		tmp=0;
 		transfer_interface_dofs(stress,tmp,0,0);
 		transfer_interface_dofs(stress,tmp,1,1,Displacement);
@@ -545,10 +622,10 @@ void FSIProblem<dim>::run ()
 		// }
 
 		LinearMap::Linearized_Operator<dim> A(this);
-		LinearMap::NeumannVector<dim> output_vector(rhs_for_adjoint.block(0), this);
+		LinearMap::InterfaceVector<dim> output_vector(rhs_for_adjoint.block(0), this);
 		output_vector *= 0;
 		// for (Vector<double>::iterator it=output_vector.begin(); it!=output_vector.end(); ++it) *it = std::max(physical_properties.rho_f,physical_properties.rho_s) * rhs_for_adjoint.block(0).l2_norm();
-		LinearMap::NeumannVector<dim> input_vector(rhs_for_adjoint.block(0), this);
+		LinearMap::InterfaceVector<dim> input_vector(rhs_for_adjoint.block(0), this);
 		//input_vector *= -1;
 		//A.vmult(output_vector, input_vector);
 		//tmp.block(0).add(-1.0, output_vector);
@@ -557,9 +634,9 @@ void FSIProblem<dim>::run ()
 		//ReductionControl solver_control(1000, 1e-50, fem_properties.cg_tolerance, false, false);
 		SolverControl solver_control(1000, 1e-50, false, false);
 		//GrowingVectorMemory<Vector<double> > mem;
-		PrimitiveVectorMemory<Vector<double> > mem;
-		SolverBicgstab<Vector<double> > solver (solver_control);//, mem, SolverBicgstab<Vector<double> >::AdditionalData(false /*exact residual */, 1.e-250 /* breakdown */));
-		A.initialize_matrix(output_vector, input_vector, linear, initialized_timestep_number);
+		PrimitiveVectorMemory<LinearMap::InterfaceVector<dim> > mem;
+		SolverBicgstab<LinearMap::InterfaceVector<dim> > solver (solver_control, mem);//, SolverBicgstab<Vector<double> >::AdditionalData(false /*exact residual */, 1.e-250 /* breakdown */));
+		A.initialize_matrix(tmp.block(0), rhs_for_adjoint.block(0), linear, initialized_timestep_number);
 		try {
 		  solver.solve(A, output_vector, input_vector, PreconditionIdentity());
 		} catch (std::exception &e) {
@@ -572,8 +649,17 @@ void FSIProblem<dim>::run ()
 		//std::cout << input_vector << std::endl; 
 
 		stress_star = stress;
-		update_direction.block(0) = output_vector;
+		update_direction.block(0) = 0;
+		output_vector.distribute(update_direction.block(0));
 		AG_line_search = true;
+		if (fem_properties.linearized_line_search)
+		  {
+		    // The linearized jump of the step is (1-alpha) jump + alpha r with the BiCGStab residual r
+		    const double jump_norm = input_vector.l2_norm();
+		    const double decrease = jump_norm - solver_control.last_value();
+		    model_alpha = linearized_line_search(update_direction.block(0), -jump_norm*decrease, decrease*decrease,
+							 1.0, velocity_jump, t_val);
+		  }
 
 		// stress.block(0).add(1.0, output_vector);
 		// tmp=0;
@@ -608,37 +694,65 @@ void FSIProblem<dim>::run ()
 		// 	update_alpha  *= 1.05;
 		// 	//velocity_jump_last_good_value = velocity_jump;
 		// }
-		double gamma = 0.9;
-		// n^A_n = gamma * norm(F(x_n))^2 / norm(F(x_{n-1}))^2
-	      
-		double n_n_A = gamma * velocity_jump / velocity_jump_old;
-		double n_n_C;
-		if (count == 1) n_n_C = n_max;
-		else n_n_C = std::min(n_max, std::max(n_n_A, gamma*std::pow(n_val,2)));
-		n_val = std::min(n_max, std::max(n_n_C, .5*tau_t/std::sqrt(velocity_jump)));
-
 		LinearMap::Linearized_Operator<dim> A(this);
-		LinearMap::NeumannVector<dim> output_vector(rhs_for_adjoint.block(0), this);
-		for (Vector<double>::iterator it=output_vector.begin(); it!=output_vector.end(); ++it) *it = std::max(physical_properties.rho_f,physical_properties.rho_s) * rhs_for_adjoint.block(0).l2_norm();
-		LinearMap::NeumannVector<dim> input_vector(rhs_for_adjoint.block(0), this);
+		LinearMap::InterfaceVector<dim> output_vector(rhs_for_adjoint.block(0), this);
+		// With a predicted control the update is small and zero is the better initial guess
+		if (fem_properties.predictor_order > 0)
+		  output_vector = 0;
+		else
+		  for (Vector<double>::iterator it=output_vector.begin(); it!=output_vector.end(); ++it) *it = std::max(physical_properties.rho_f,physical_properties.rho_s) * rhs_for_adjoint.block(0).l2_norm();
+		LinearMap::InterfaceVector<dim> input_vector(rhs_for_adjoint.block(0), this);
+
+		// Forcing terms of Eisenstat and Walker from the interface residuals |F_k| = |input_vector|:
+		// EW1 |F_k - (F_{k-1} + J s_{k-1})| / |F_{k-1}|, EW2 gamma (|F_k|/|F_{k-1}|)^alpha, each kept from
+		// dropping too fast, bounded by forcing max and not below what the outer tolerance needs
+		const double residual_norm = input_vector.l2_norm();
+		if (fem_properties.forcing_term.compare("constant")!=0 && previous_residual_norm > 0)
+		  {
+		    const double forcing_old = forcing;
+		    if (fem_properties.forcing_term.compare("EW1")==0)
+		      {
+			const double exponent = .5*(1+std::sqrt(5.));
+			forcing = std::fabs(residual_norm - previous_linear_residual)/previous_residual_norm;
+			if (std::pow(forcing_old, exponent) > 0.1)
+			  forcing = std::max(forcing, std::pow(forcing_old, exponent));
+		      }
+		    else
+		      {
+			forcing = fem_properties.forcing_gamma*std::pow(residual_norm/previous_residual_norm, fem_properties.forcing_alpha);
+			if (fem_properties.forcing_gamma*std::pow(forcing_old, fem_properties.forcing_alpha) > 0.1)
+			  forcing = std::max(forcing, fem_properties.forcing_gamma*std::pow(forcing_old, fem_properties.forcing_alpha));
+		      }
+		    if (residual_norm > 0)
+		      forcing = std::max(forcing, .5*std::sqrt(2*fem_properties.jump_tolerance)/residual_norm);
+		    forcing = std::min(forcing, fem_properties.forcing_max);
+		  }
 		//input_vector *= -1;
 		//A.vmult(output_vector, input_vector);
 		//tmp.block(0).add(-1.0, output_vector);
 		// total_solves is passed by reference and updated
 		unsigned int convergence_flag = 1;
-		//ReductionControl solver_control(1000, 1e-50, n_val, false, false);
-		ReductionControl solver_control(1000, 1e-50, fem_properties.cg_tolerance, false, false);
+		// The constant choice reduces the initial GMRES residual by cg tolerance, the adaptive
+		// ones require |F_k + J s_k| <= forcing |F_k|
+		const bool constant_forcing = fem_properties.forcing_term.compare("constant")==0;
+		ReductionControl solver_control(1000, constant_forcing ? 1e-50 : forcing*residual_norm,
+						constant_forcing ? fem_properties.cg_tolerance : 0., false, false);
 		//SolverControl solver_control(1000, 1e-50, false, false);
-		PrimitiveVectorMemory<Vector<double> > mem;
-		SolverGMRES<Vector<double> > solver (solver_control, mem, SolverGMRES<Vector<double> >::AdditionalData(53,false));
-		A.initialize_matrix(output_vector, input_vector, linear, initialized_timestep_number);
+		PrimitiveVectorMemory<LinearMap::InterfaceVector<dim> > mem;
+		SolverGMRES<LinearMap::InterfaceVector<dim> > solver (solver_control, mem, typename SolverGMRES<LinearMap::InterfaceVector<dim> >::AdditionalData(53,false));
+		A.initialize_matrix(tmp.block(0), rhs_for_adjoint.block(0), linear, initialized_timestep_number);
 		try {
-		  solver.solve(A, output_vector, input_vector, PreconditionIdentity());
+		  if (fem_properties.recycle_dimension > 0)
+		    recycling_gmres.solve(A, output_vector, input_vector, solver_control);
+		  else
+		    solver.solve(A, output_vector, input_vector, PreconditionIdentity());
 		} catch (std::exception &e) {
 		  Assert (false, ExcMessage(e.what()));
 		}
 	      
 		m_val = -solver_control.last_value();
+		previous_residual_norm = residual_norm;
+		previous_linear_residual = solver_control.last_value();
 		double c_val = 0.5;
 		t_val = -m_val*c_val;
 		t_val = 0;
@@ -648,8 +762,17 @@ void FSIProblem<dim>::run ()
 		std::cout << "last step:" << solver_control.last_step() << std::endl;
 		//std::cout << input_vector << std::endl; 
 		//stress_star = stress;
-		update_direction.block(0) = output_vector;
+		update_direction.block(0) = 0;
+		output_vector.distribute(update_direction.block(0));
 		AG_line_search = true;
+		if (fem_properties.linearized_line_search)
+		  {
+		    // The linearized jump of the step is (1-alpha) jump + alpha r with the GMRES residual r,
+		    // modeled by its upper bound (1-alpha)|jump| + alpha|r|
+		    const double decrease = residual_norm - solver_control.last_value();
+		    model_alpha = linearized_line_search(update_direction.block(0), -residual_norm*decrease, decrease*decrease,
+							 1.0, velocity_jump, t_val);
+		  }
 		// stress.block(0).add(update_alpha, output_vector);
 		// tmp=0;
 		// transfer_interface_dofs(stress,tmp,0,0);
@@ -663,6 +786,15 @@ void FSIProblem<dim>::run ()
 		// 	convergence_flag = optimization_GMRES(total_solves, initialized_timestep_number, true, 1);
 		// }
 	      }
+
+	    // A step accepted by the model skips the nonlinear trial: the next iteration solves at the new
+	    // control anyway and checks the decrease there
+	    if (model_alpha > 0)
+	      {
+		alpha_j = model_alpha;
+		AG_line_search = false;
+		model_step = true;
+	      }
 	  }
   	}
 
@@ -677,6 +809,8 @@ void FSIProblem<dim>::run ()
   	}
       old_solution = solution;
       old_stress = stress;
+      stress_history.push(stress);
+      solution_history.push(solution);
 
       // *****************************************************************************************
       //                                SAVE CALCULATED VARIABLES
@@ -836,3 +970,5 @@ void FSIProblem<dim>::run ()
 
 
 template void FSIProblem<2>::run ();
+template double FSIProblem<2>::linearized_line_search (const Vector<double> &step, const double jump_slope, const double jump_curvature,
+							const double alpha_0, const double objective, const double t_val);
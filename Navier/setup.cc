@@ -15,50 +15,8 @@ void FSIProblem<dim>::dirichlet_boundaries (System system, Mode enum_)
     {
       if (system==Fluid)
 	{
-	  FluidBoundaryValues<dim> fluid_boundary_values_function(physical_properties, fem_properties);
-	  fluid_boundary_values_function.set_time (time);
 	  std::map<types::global_dof_index,double> fluid_boundary_values;
-
-	  std::map<types::global_dof_index,double> fluid_structure_boundary_values;
-	  if (fem_properties.optimization_method.compare("DN")==0)
-	    {
-	      for (unsigned int i=0; i<dofs_per_big_block[0]; ++i) // loops over nodes local to ale
-		{
-		  if (f2v.count(i)) // lookup key for certain ale dof
-		    {
-		      fluid_structure_boundary_values.insert(std::pair<unsigned int,double>(i,solution.block(1)[f2v[i]]));
-		    }
-		}
-	    }
-
-	  for (unsigned int i=min_index; i<fluid_boundaries.size()+min_index; ++i)
-	    {
-	      if (fluid_boundaries[i]==Dirichlet)
-		{
-		  if (physical_properties.simulation_type!=1)
-		    {
-		      VectorTools::interpolate_boundary_values (fluid_dof_handler,
-								i,
-								fluid_boundary_values_function,
-								fluid_boundary_values,
-								fluid_fe.component_mask(velocities));
-		    }
-		  else
-		    {
-		      VectorTools::interpolate_boundary_values (fluid_dof_handler,
-								i,
-								ZeroFunction<dim>(dim+1),
-								fluid_boundary_values,
-								fluid_fe.component_mask(velocities));
-		    }
-		}
-	    }
-	  if (fem_properties.optimization_method.compare("DN")==0) {
-	    MatrixTools::apply_boundary_values (fluid_structure_boundary_values,
-						system_matrix.block(0,0),
-						solution.block(0),
-						system_rhs.block(0));
-	  }
+	  fluid_state_boundary_values(fluid_boundary_values);
 	  MatrixTools::apply_boundary_values (fluid_boundary_values,
 					      system_matrix.block(0,0),
 					      solution.block(0),
@@ -67,19 +25,8 @@ void FSIProblem<dim>::dirichlet_boundaries (System system, Mode enum_)
 	}
       else if (system==Structure)
 	{
-	  StructureBoundaryValues<dim> structure_boundary_values_function(physical_properties);
-	  structure_boundary_values_function.set_time (time);
 	  std::map<types::global_dof_index,double> structure_boundary_values;
-	  for (unsigned int i=min_index; i<structure_boundaries.size()+min_index; ++i)
-	    {
-	      if (structure_boundaries[i]==Dirichlet)
-		{
-		  VectorTools::interpolate_boundary_values (structure_dof_handler,
-							    i,
-							    structure_boundary_values_function,
-							    structure_boundary_values);
-		}
-	    }
+	  structure_state_boundary_values(structure_boundary_values);
 	  MatrixTools::apply_boundary_values (structure_boundary_values,
 					      system_matrix.block(1,1),
 					      solution.block(1),
@@ -87,31 +34,9 @@ void FSIProblem<dim>::dirichlet_boundaries (System system, Mode enum_)
 	}
       else
 	{
-	  std::map<types::global_dof_index,double> ale_dirichlet_boundary_values;
-	  std::map<types::global_dof_index,double> ale_interface_boundary_values;
-	  for (unsigned int i=0; i<dofs_per_big_block[2]; ++i) // loops over nodes local to ale
-	    {
-	      if (a2n.count(i)) // lookup key for certain ale dof
-		{
-		  ale_interface_boundary_values.insert(std::pair<unsigned int,double>(i,solution.block(1)[a2n[i]]));
-		}
-	    }
-	  for (unsigned int i=min_index; i<ale_boundaries.size()+min_index; ++i)
-	    {
-	      if (ale_boundaries[i]==Dirichlet)
-		{
-		  VectorTools::interpolate_boundary_values (ale_dof_handler,
-							    i,
-							    ZeroFunction<dim>(dim),
-							    ale_dirichlet_boundary_values,
-							    ale_fe.component_mask(ale_displacement));
-		}
-	    }
-	  MatrixTools::apply_boundary_values (ale_dirichlet_boundary_values,
-					      system_matrix.block(2,2),
-					      solution.block(2),
-					      system_rhs.block(2));
-	  MatrixTools::apply_boundary_values (ale_interface_boundary_values,
+	  std::map<types::global_dof_index,double> ale_boundary_values;
+	  ale_state_boundary_values(ale_boundary_values);
+	  MatrixTools::apply_boundary_values (ale_boundary_values,
 					      system_matrix.block(2,2),
 					      solution.block(2),
 					      system_rhs.block(2));
@@ -122,21 +47,11 @@ void FSIProblem<dim>::dirichlet_boundaries (System system, Mode enum_)
       if (system==Fluid)
 	{
 	  std::map<types::global_dof_index,double> fluid_boundary_values;
-	  for (unsigned int i=min_index; i<fluid_boundaries.size()+min_index; ++i)
-	    {
-	      if (fluid_boundaries[i]==Dirichlet)// non interface or Neumann sides
-		{
-		  VectorTools::interpolate_boundary_values (fluid_dof_handler,
-							    i,
-							    ZeroFunction<dim>(dim+1),
-							    fluid_boundary_values,
-							    fluid_fe.component_mask(velocities));
-		}
-	    }
+	  linearized_boundary_values(system, fluid_boundary_values);
 	  if (enum_==adjoint)
 	    {
 	      MatrixTools::apply_boundary_values (fluid_boundary_values,
-						  adjoint_matrix.block(0,0),
+						  fem_properties.transposed_adjoint ? linear_matrix.block(0,0) : adjoint_matrix.block(0,0),
 						  adjoint_solution.block(0),
 						  adjoint_rhs.block(0));
 	    }
@@ -151,21 +66,11 @@ void FSIProblem<dim>::dirichlet_boundaries (System system, Mode enum_)
       else if (system==Structure)
 	{
 	  std::map<types::global_dof_index,double> structure_boundary_values;
-	  for (unsigned int i=min_index; i<structure_boundaries.size()+min_index; ++i)
-	    {
-	      if (structure_boundaries[i]==Dirichlet)// non interface or Neumann sides
-		{
-		  VectorTools::interpolate_boundary_values (structure_dof_handler,
-							    i,
-							    ZeroFunction<dim>(2*dim),
-							    structure_boundary_values,
-							    structure_fe.component_mask(displacements));
-		}
-	    }
+	  linearized_boundary_values(system, structure_boundary_values);
 	  if (enum_==adjoint)
 	    {
 	      MatrixTools::apply_boundary_values (structure_boundary_values,
-						  adjoint_matrix.block(1,1),
+						  fem_properties.transposed_adjoint ? linear_matrix.block(1,1) : adjoint_matrix.block(1,1),
 						  adjoint_solution.block(1),
 						  adjoint_rhs.block(1));
 	    }
@@ -180,20 +85,11 @@ void FSIProblem<dim>::dirichlet_boundaries (System system, Mode enum_)
       else
 	{
 	  std::map<types::global_dof_index,double> ale_boundary_values;
-	  for (unsigned int i=min_index; i<ale_boundaries.size()+min_index; ++i)
-	    {
-	      if (ale_boundaries[i]==Dirichlet || ale_boundaries[i]==Interface)// non interface or Neumann sides
-		{
-		  VectorTools::interpolate_boundary_values (ale_dof_handler,
-							    i,
-							    ZeroFunction<dim>(dim),
-							    ale_boundary_values);
-		}
-	    }
+	  linearized_boundary_values(system, ale_boundary_values);
 	  if (enum_==adjoint)
 	    {
 	      MatrixTools::apply_boundary_values (ale_boundary_values,
-						  adjoint_matrix.block(2,2),
+						  fem_properties.transposed_adjoint ? linear_matrix.block(2,2) : adjoint_matrix.block(2,2),
 						  adjoint_solution.block(2),
 						  adjoint_rhs.block(2));
 	    }	
@@ -208,6 +104,153 @@ void FSIProblem<dim>::dirichlet_boundaries (System system, Mode enum_)
     }
 }
 
+template <int dim>
+void FSIProblem<dim>::linearized_boundary_values (System system, std::map<types::global_dof_index,double> &boundary_values)
+{
+  // Homogeneous conditions shared by the linearized and adjoint systems
+  const FEValuesExtractors::Vector velocities (0);
+  const FEValuesExtractors::Vector displacements (0);
+
+  unsigned int min_index=0;
+  if (physical_properties.simulation_type==3) min_index=1;
+
+  if (system==Fluid)
+    {
+      for (unsigned int i=min_index; i<fluid_boundaries.size()+min_index; ++i)
+	{
+	  if (fluid_boundaries[i]==Dirichlet)// non interface or Neumann sides
+	    {
+	      VectorTools::interpolate_boundary_values (fluid_dof_handler,
+							i,
+							ZeroFunction<dim>(dim+1),
+							boundary_values,
+							fluid_fe.component_mask(velocities));
+	    }
+	}
+    }
+  else if (system==Structure)
+    {
+      for (unsigned int i=min_index; i<structure_boundaries.size()+min_index; ++i)
+	{
+	  if (structure_boundaries[i]==Dirichlet)// non interface or Neumann sides
+	    {
+	      VectorTools::interpolate_boundary_values (structure_dof_handler,
+							i,
+							ZeroFunction<dim>(2*dim),
+							boundary_values,
+							structure_fe.component_mask(displacements));
+	    }
+	}
+    }
+  else
+    {
+      for (unsigned int i=min_index; i<ale_boundaries.size()+min_index; ++i)
+	{
+	  if (ale_boundaries[i]==Dirichlet || ale_boundaries[i]==Interface)// non interface or Neumann sides
+	    {
+	      VectorTools::interpolate_boundary_values (ale_dof_handler,
+							i,
+							ZeroFunction<dim>(dim),
+							boundary_values);
+	    }
+	}
+    }
+}
+
+template <int dim>
+void FSIProblem<dim>::fluid_state_boundary_values (std::map<types::global_dof_index,double> &fluid_boundary_values)
+{
+  const FEValuesExtractors::Vector velocities (0);
+
+  unsigned int min_index=0;
+  if (physical_properties.simulation_type==3) min_index=1;
+
+  FluidBoundaryValues<dim> fluid_boundary_values_function(physical_properties, fem_properties);
+  fluid_boundary_values_function.set_time (time);
+
+  fluid_boundary_values.clear();
+  for (unsigned int i=min_index; i<fluid_boundaries.size()+min_index; ++i)
+    {
+      if (fluid_boundaries[i]==Dirichlet)
+	{
+	  if (physical_properties.simulation_type!=1)
+	    {
+	      VectorTools::interpolate_boundary_values (fluid_dof_handler,
+							i,
+							fluid_boundary_values_function,
+							fluid_boundary_values,
+							fluid_fe.component_mask(velocities));
+	    }
+	  else
+	    {
+	      VectorTools::interpolate_boundary_values (fluid_dof_handler,
+							i,
+							ZeroFunction<dim>(dim+1),
+							fluid_boundary_values,
+							fluid_fe.component_mask(velocities));
+	    }
+	}
+    }
+  // Dirichlet-Neumann coupling prescribes the structure velocity on the interface;
+  // Dirichlet sides take precedence on shared dofs
+  if (fem_properties.optimization_method.compare("DN")==0)
+    {
+      for (unsigned int k=0; k<f2v.size(); ++k) // loops over fluid interface nodes
+	{
+	  fluid_boundary_values.insert(std::pair<unsigned int,double>(f2v.from[k],solution.block(1)[f2v.to[k]]));
+	}
+    }
+}
+
+template <int dim>
+void FSIProblem<dim>::structure_state_boundary_values (std::map<types::global_dof_index,double> &structure_boundary_values)
+{
+  unsigned int min_index=0;
+  if (physical_properties.simulation_type==3) min_index=1;
+
+  StructureBoundaryValues<dim> structure_boundary_values_function(physical_properties);
+  structure_boundary_values_function.set_time (time);
+
+  structure_boundary_values.clear();
+  for (unsigned int i=min_index; i<structure_boundaries.size()+min_index; ++i)
+    {
+      if (structure_boundaries[i]==Dirichlet)
+	{
+	  VectorTools::interpolate_boundary_values (structure_dof_handler,
+						    i,
+						    structure_boundary_values_function,
+						    structure_boundary_values);
+	}
+    }
+}
+
+template <int dim>
+void FSIProblem<dim>::ale_state_boundary_values (std::map<types::global_dof_index,double> &ale_boundary_values)
+{
+  const FEValuesExtractors::Vector ale_displacement (0);
+
+  unsigned int min_index=0;
+  if (physical_properties.simulation_type==3) min_index=1;
+
+  ale_boundary_values.clear();
+  for (unsigned int i=min_index; i<ale_boundaries.size()+min_index; ++i)
+    {
+      if (ale_boundaries[i]==Dirichlet)
+	{
+	  VectorTools::interpolate_boundary_values (ale_dof_handler,
+						    i,
+						    ZeroFunction<dim>(dim),
+						    ale_boundary_values,
+						    ale_fe.component_mask(ale_displacement));
+	}
+    }
+  // Interface values follow the structure displacement and take precedence on shared dofs
+  for (unsigned int k=0; k<a2n.size(); ++k) // loops over ale interface nodes
+    {
+      ale_boundary_values[a2n.from[k]] = solution.block(1)[a2n.to[k]];
+    }
+}
+
 template <int dim>
 void FSIProblem<dim>::setup_system ()
 {
@@ -578,7 +621,7 @@ void FSIProblem<dim>::setup_system ()
 
 
   system_matrix.reinit (sparsity_pattern);
-  adjoint_matrix.reinit (sparsity_pattern);
+  if (!fem_properties.transposed_adjoint) adjoint_matrix.reinit (sparsity_pattern);
   linear_matrix.reinit (sparsity_pattern);
 
   solution.reinit (n_big_blocks);
@@ -636,6 +679,9 @@ void FSIProblem<dim>::setup_system ()
       old_mesh_displacement.block(i).reinit (dofs_per_big_block[i]);
       mesh_velocity.block(i).reinit (dofs_per_big_block[i]);
     }
+  fluid_eulerian_mapping.reset(new MappingQEulerian<dim>(fem_properties.ale_degree,
+							mesh_displacement_star.block(2),
+							ale_dof_handler));
   solution.collect_sizes ();
   solution_star.collect_sizes ();
   rhs_for_adjoint.collect_sizes ();
@@ -666,8 +712,57 @@ void FSIProblem<dim>::setup_system ()
   fluid_constraints.close ();
   structure_constraints.close ();
   ale_constraints.close ();
+
+  if (fem_properties.colored_assembly)
+    {
+      // Cells of one color write to disjoint rows only if no constraint couples their dofs
+      AssertThrow(fluid_constraints.n_constraints()==0 && structure_constraints.n_constraints()==0
+		  && ale_constraints.n_constraints()==0, ExcNotImplemented());
+      color_cells(fluid_dof_handler, fluid_colors);
+      color_cells(structure_dof_handler, structure_colors);
+      color_cells(ale_dof_handler, ale_colors);
+    }
+}
+
+template <int dim>
+void FSIProblem<dim>::color_cells (const DoFHandler<dim> &dof_handler, CellColoring &colors)
+{
+  // Greedy coloring of the graph in which two cells are adjacent if they share a dof:
+  // each cell gets the first color none of whose cells touches one of its dofs
+  colors.clear();
+  std::vector<std::vector<bool> > dof_used;
+  std::vector<types::global_dof_index> dof_indices (dof_handler.get_fe().dofs_per_cell);
+
+  typename DoFHandler<dim>::active_cell_iterator
+    cell = dof_handler.begin_active(),
+    endc = dof_handler.end();
+  for (; cell!=endc; ++cell)
+    {
+      cell->get_dof_indices (dof_indices);
+      unsigned int color = 0;
+      for (; color<colors.size(); ++color)
+	{
+	  bool conflict = false;
+	  for (unsigned int k=0; k<dof_indices.size() && !conflict; ++k)
+	    conflict = dof_used[color][dof_indices[k]];
+	  if (!conflict) break;
+	}
+      if (color==colors.size())
+	{
+	  colors.push_back(std::vector<typename DoFHandler<dim>::active_cell_iterator>());
+	  dof_used.push_back(std::vector<bool>(dof_handler.n_dofs(), false));
+	}
+      for (unsigned int k=0; k<dof_indices.size(); ++k)
+	dof_used[color][dof_indices[k]] = true;
+      colors[color].push_back(cell);
+    }
 }
 
 
 template void FSIProblem<2>::dirichlet_boundaries (System system, Mode enum_);
+template void FSIProblem<2>::linearized_boundary_values (System system, std::map<types::global_dof_index,double> &boundary_values);
+template void FSIProblem<2>::fluid_state_boundary_values (std::map<types::global_dof_index,double> &fluid_boundary_values);
+template void FSIProblem<2>::structure_state_boundary_values (std::map<types::global_dof_index,double> &structure_boundary_values);
+template void FSIProblem<2>::ale_state_boundary_values (std::map<types::global_dof_index,double> &ale_boundary_values);
 template void FSIProblem<2>::setup_system ();
+template void FSIProblem<2>::color_cells (const DoFHandler<2> &dof_handler, CellColoring &colors);
@@ -2,6 +2,7 @@
 #define SMALL_CLASSES_H
 #include "data1.h"
 #include "parameters.h"
+#include <algorithm>
 
 using namespace dealii;
 
@@ -55,6 +56,164 @@ class Info
   }
 };
 
+// Interface dof correspondence between two numberings (fluid, structure, ALE)
+// stored as contiguous index arrays sorted by the source dof, so that moving
+// interface values is a plain gather/scatter instead of a tree walk.
+class InterfaceMap
+{
+ public:
+  std::vector<types::global_dof_index> from;
+  std::vector<types::global_dof_index> to;
+
+  void add (const types::global_dof_index from_, const types::global_dof_index to_)
+  {
+    from.push_back(from_);
+    to.push_back(to_);
+  }
+  // Sort by source dof and drop repeated source dofs, keeping the first one added
+  void compress ()
+  {
+    std::vector<std::pair<types::global_dof_index, types::global_dof_index> > pairs(from.size());
+    for (unsigned int k=0; k<from.size(); ++k)
+      pairs[k] = std::make_pair(from[k], to[k]);
+    std::stable_sort(pairs.begin(), pairs.end(), by_source);
+    pairs.erase(std::unique(pairs.begin(), pairs.end(), same_source), pairs.end());
+    from.resize(pairs.size());
+    to.resize(pairs.size());
+    for (unsigned int k=0; k<pairs.size(); ++k)
+      {
+	from[k] = pairs[k].first;
+	to[k] = pairs[k].second;
+      }
+  }
+  unsigned int size () const
+  {
+    return from.size();
+  }
+  // dst[to[k]] = src[from[k]]
+  void transfer (const Vector<double> &src, Vector<double> &dst) const
+  {
+    const unsigned int n = from.size();
+    if (n==0) return;
+    const types::global_dof_index *from_index = &from[0];
+    const types::global_dof_index *to_index = &to[0];
+    const double *src_values = src.begin();
+    double *dst_values = dst.begin();
+    for (unsigned int k=0; k<n; ++k)
+      dst_values[to_index[k]] = src_values[from_index[k]];
+  }
+  // dst[from[k]] = src[from[k]], i.e. copy the source interface entries in place
+  void copy (const Vector<double> &src, Vector<double> &dst) const
+  {
+    const unsigned int n = from.size();
+    if (n==0) return;
+    const types::global_dof_index *from_index = &from[0];
+    const double *src_values = src.begin();
+    double *dst_values = dst.begin();
+    for (unsigned int k=0; k<n; ++k)
+      dst_values[from_index[k]] = src_values[from_index[k]];
+  }
+
+ private:
+  static bool by_source (const std::pair<types::global_dof_index, types::global_dof_index> &first,
+			 const std::pair<types::global_dof_index, types::global_dof_index> &second)
+  {
+    return first.first < second.first;
+  }
+  static bool same_source (const std::pair<types::global_dof_index, types::global_dof_index> &first,
+			   const std::pair<types::global_dof_index, types::global_dof_index> &second)
+  {
+    return first.first == second.first;
+  }
+};
+
+// The vectors of the last few accepted time steps in a ring buffer, (*this)[0] being the newest,
+// used to extrapolate the initial iterates of the next time step
+class StepHistory
+{
+ public:
+  StepHistory (const unsigned int capacity_=3): capacity(capacity_), newest(0) {};
+
+  void push (const BlockVector<double> &v)
+  {
+    if (values.size() < capacity)
+      {
+	values.push_back(v);
+	newest = values.size()-1;
+      }
+    else
+      {
+	newest = (newest+1)%capacity;
+	values[newest] = v;
+      }
+  }
+  unsigned int size () const
+  {
+    return values.size();
+  }
+  const BlockVector<double> & operator[] (const unsigned int i) const
+  {
+    Assert (i<values.size(), ExcIndexRange(i,0,values.size()));
+    return values[(newest+values.size()-i)%values.size()];
+  }
+  // Constant step extrapolation to the next time step, linear (2 x_n - x_{n-1}) or quadratic
+  // (3 x_n - 3 x_{n-1} + x_{n-2}), lowered to what the stored steps allow
+  void extrapolate (const unsigned int order, BlockVector<double> &v) const
+  {
+    Assert (values.size()>0, ExcNotInitialized());
+    static const double coefficients[3][3] = {{1, 0, 0}, {2, -1, 0}, {3, -3, 1}};
+    const unsigned int p = std::min(std::min(order, size()-1), 2u);
+    v = (*this)[0];
+    v *= coefficients[p][0];
+    for (unsigned int i=1; i<=p; ++i)
+      v.add(coefficients[p][i], (*this)[i]);
+  }
+
+ private:
+  const unsigned int capacity;
+  unsigned int newest;
+  std::vector<BlockVector<double> > values;
+};
+
+// Contraction monitor of a modified Newton iteration: the lagged Jacobian is refactored before its
+// first use and whenever an update is not below refresh_ratio times the previous one of the same solve
+class JacobianMonitor
+{
+ public:
+ JacobianMonitor (): refresh_ratio(0.5), previous_norm(0), stale(true) {};
+
+  void initialize (const double refresh_ratio_)
+  {
+    refresh_ratio = refresh_ratio_;
+    previous_norm = 0;
+    stale = true;
+  }
+  // Updates are only compared within one nonlinear solve
+  void new_solve ()
+  {
+    previous_norm = 0;
+  }
+  bool needs_refresh () const
+  {
+    return stale;
+  }
+  void refreshed ()
+  {
+    stale = false;
+  }
+  void update (const double norm)
+  {
+    if (previous_norm > 0 && norm > refresh_ratio*previous_norm)
+      stale = true;
+    previous_norm = norm;
+  }
+
+ private:
+  double refresh_ratio;
+  double previous_norm;
+  bool stale;
+};
+
 template <int dim>
 struct PerTaskData {
   FullMatrix<double> cell_matrix;
@@ -99,10 +258,23 @@ struct BaseScratchData {
     n_q_points (quadrature.size())
   {}
 
+  BaseScratchData (const Mapping<dim> &mapping,
+	       const FiniteElement<dim> &fe,
+	       const Quadrature<dim> &quadrature,
+	       const UpdateFlags update_flags,
+	       const unsigned int mode_type_
+	       )
+  :
+  mode_type(mode_type_),
+    fe_values (mapping, fe, quadrature, update_flags),
+    n_q_points (quadrature.size())
+  {}
+
   BaseScratchData (const BaseScratchData &scratch)
   :
   mode_type(scratch.mode_type),
-    fe_values (scratch.fe_values.get_fe(),
+    fe_values (scratch.fe_values.get_mapping(),
+	       scratch.fe_values.get_fe(),
 	       scratch.fe_values.get_quadrature(),
 	       scratch.fe_values.get_update_flags()
 	       ),
@@ -128,9 +300,23 @@ struct FullScratchData : public BaseScratchData<dim> {
     n_face_q_points(face_quadrature.size())
       {}
       
+  FullScratchData ( const Mapping<dim> &mapping,
+			  const FiniteElement<dim> &fe,
+			  const Quadrature<dim> &quadrature,
+			  const UpdateFlags update_flags,
+			  const Quadrature<dim-1> &face_quadrature,
+			  const UpdateFlags face_update_flags,
+			  const unsigned int mode_type_
+			  )
+    : BaseScratchData<dim>(mapping, fe, quadrature, update_flags, mode_type_),
+    fe_face_values (mapping, fe, face_quadrature, face_update_flags),
+    n_face_q_points(face_quadrature.size())
+      {}
+
   FullScratchData (const FullScratchData &scratch)
     : BaseScratchData<dim>(scratch),
-    fe_face_values(scratch.fe_face_values.get_fe(),
+    fe_face_values(scratch.fe_face_values.get_mapping(),
+		   scratch.fe_face_values.get_fe(),
   		   scratch.fe_face_values.get_quadrature(),
   		   scratch.fe_face_values.get_update_flags()
   		   ),
@@ -138,33 +324,189 @@ struct FullScratchData : public BaseScratchData<dim> {
       {}
 };
 
-/* template <int dim>
-struct FluidScratchData : public FullScratchData<dim> {
-  FEValues<dim> fe_vertices_values;
-  unsigned int n_vertices_q_points;
-  FluidScratchData ( const FiniteElement<dim> &fe,
-		    const Quadrature<dim> &quadrature,
-		    const UpdateFlags update_flags,
-		    const Quadrature<dim-1> &face_quadrature,
-		    const UpdateFlags face_update_flags,
-		    const unsigned int mode_type_,
-		    const Quadrature<dim> &vertices_quadrature,
-		    const UpdateFlags vertices_update_flags
-		    )
+// Structure kernel scratch: the shape function tables of the current quadrature point
+// (stored per dof, structure of arrays) and the split of the cell dofs into displacement
+// and velocity dofs are kept here, so the kernel allocates nothing per cell and its
+// loops only visit the nonzero component blocks. The forcing and stress functions
+// and the face buffers of the stresses kernel are owned here as well.
+template <int dim>
+struct StructureScratchData : public FullScratchData<dim> {
+  std::vector<unsigned int> component;
+  std::vector<unsigned int> displacement_dofs;
+  std::vector<unsigned int> velocity_dofs;
+
+  std::vector<Tensor<1,dim,double> > phi_n;
+  std::vector<Tensor<1,dim,double> > phi_v;
+  std::vector<Tensor<2,dim,double> > grad_phi_n;
+  std::vector<Tensor<2,dim,double> > symgrad_phi_n;
+  std::vector<Tensor<2,dim,double> > S;
+  std::vector<Tensor<2,dim,double> > S2;
+
+  std::vector<Vector<double> > old_solution_values;
+  std::vector<Tensor<2,dim,double> > grad_n_star;
+  std::vector<Tensor<2,dim,double> > grad_n_old;
+  std::vector<Tensor<1,dim,double> > stress_values;
+
+  std::vector<Vector<double> > g_stress_values;
+  std::vector<Vector<double> > adjoint_rhs_values;
+  std::vector<Vector<double> > linear_rhs_values;
+  std::vector<double> coordinate_transformation_multiplier_old;
+  std::vector<double> coordinate_transformation_multiplier_star;
+  std::vector<Tensor<2,dim,double> > face_grad_n_star;
+  std::vector<Tensor<2,dim,double> > face_grad_n_old;
+
+  StructureRightHandSide<dim> rhs_function;
+  StructureStressValues<dim> structure_stress_values;
+  StructureStressValues<dim> old_structure_stress_values;
+
+  StructureScratchData ( const FiniteElement<dim> &fe,
+			 const Quadrature<dim> &quadrature,
+			 const UpdateFlags update_flags,
+			 const Quadrature<dim-1> &face_quadrature,
+			 const UpdateFlags face_update_flags,
+			 const unsigned int mode_type_,
+			 const Parameters::PhysicalProperties &physical_properties
+			 )
     : FullScratchData<dim>(fe, quadrature, update_flags, face_quadrature, face_update_flags, mode_type_),
-    fe_vertices_values(fe, vertices_quadrature, vertices_update_flags),
-    n_vertices_q_points(vertices_quadrature.size())
-      {}
-      
+    rhs_function(physical_properties),
+    structure_stress_values(physical_properties),
+    old_structure_stress_values(physical_properties)
+  {
+    init_tables(fe);
+  }
+
+  StructureScratchData (const StructureScratchData &scratch)
+    : FullScratchData<dim>(scratch),
+    rhs_function(scratch.rhs_function.physical_properties),
+    structure_stress_values(scratch.structure_stress_values.physical_properties),
+    old_structure_stress_values(scratch.old_structure_stress_values.physical_properties)
+  {
+    init_tables(scratch.fe_values.get_fe());
+  }
+
+ private:
+  void init_tables (const FiniteElement<dim> &fe)
+  {
+    const unsigned int dofs_per_cell = fe.dofs_per_cell;
+    component.resize(dofs_per_cell);
+    displacement_dofs.clear();
+    velocity_dofs.clear();
+    for (unsigned int k=0; k<dofs_per_cell; ++k)
+      {
+	component[k] = fe.system_to_component_index(k).first;
+	if (component[k]<dim) displacement_dofs.push_back(k);
+	else velocity_dofs.push_back(k);
+      }
+    phi_n.assign(dofs_per_cell, Tensor<1,dim,double>());
+    phi_v.assign(dofs_per_cell, Tensor<1,dim,double>());
+    grad_phi_n.assign(dofs_per_cell, Tensor<2,dim,double>());
+    symgrad_phi_n.assign(dofs_per_cell, Tensor<2,dim,double>());
+    S.assign(dofs_per_cell, Tensor<2,dim,double>());
+    S2.assign(dofs_per_cell, Tensor<2,dim,double>());
+
+    old_solution_values.assign(this->n_q_points, Vector<double>(fe.n_components()));
+    grad_n_star.assign(this->n_q_points, Tensor<2,dim,double>());
+    grad_n_old.assign(this->n_q_points, Tensor<2,dim,double>());
+    stress_values.assign(2*dim, Tensor<1,dim,double>());
+
+    g_stress_values.assign(this->n_face_q_points, Vector<double>(2*dim));
+    adjoint_rhs_values.assign(this->n_face_q_points, Vector<double>(2*dim));
+    linear_rhs_values.assign(this->n_face_q_points, Vector<double>(2*dim));
+    coordinate_transformation_multiplier_old.assign(this->n_face_q_points, 0.);
+    coordinate_transformation_multiplier_star.assign(this->n_face_q_points, 0.);
+    face_grad_n_star.assign(this->n_face_q_points, Tensor<2,dim,double>());
+    face_grad_n_old.assign(this->n_face_q_points, Tensor<2,dim,double>());
+  }
+};
+
+// Fluid kernel scratch: the solution buffers at the cell and face quadrature points,
+// the shape function tables and the boundary functions used by the fluid kernel,
+// sized once per thread and reused for every cell.
+template <int dim>
+struct FluidScratchData : public FullScratchData<dim> {
+  std::vector<Vector<double> > old_solution_values;
+  std::vector<Vector<double> > old_old_solution_values;
+  std::vector<Vector<double> > u_star_values;
+  std::vector<Vector<double> > z;
+
+  std::vector<Tensor<2,dim,double> > grad_u_old;
+  std::vector<Tensor<2,dim,double> > grad_u_old_old;
+  std::vector<Tensor<2,dim,double> > grad_u_star;
+  std::vector<Tensor<2,dim,double> > F;
+  std::vector<Tensor<2,dim,double> > grad_z;
+
+  std::vector<Vector<double> > adjoint_rhs_values;
+  std::vector<Vector<double> > linear_rhs_values;
+  std::vector<Vector<double> > g_stress_values;
+  std::vector<Vector<double> > old_solution_side_values;
+  std::vector<Vector<double> > old_old_solution_side_values;
+  std::vector<Vector<double> > u_star_side_values;
+  std::vector<Tensor<1,dim,double> > stress_values;
+  Vector<double> u_true_side_values;
+
+  std::vector<Tensor<1,dim,double> > phi_u;
+  std::vector<Tensor<2,dim,double> > grad_phi_u;
+  std::vector<double> div_phi_u;
+
+  FluidStressValues<dim> fluid_stress_values;
+  FluidBoundaryValues<dim> fluid_boundary_values_function;
+
+  FluidScratchData ( const Mapping<dim> &mapping,
+		     const FiniteElement<dim> &fe,
+		     const Quadrature<dim> &quadrature,
+		     const UpdateFlags update_flags,
+		     const Quadrature<dim-1> &face_quadrature,
+		     const UpdateFlags face_update_flags,
+		     const unsigned int mode_type_,
+		     const Parameters::PhysicalProperties &physical_properties,
+		     const Parameters::SimulationProperties &fem_properties
+		     )
+    : FullScratchData<dim>(mapping, fe, quadrature, update_flags, face_quadrature, face_update_flags, mode_type_),
+    fluid_stress_values(physical_properties),
+    fluid_boundary_values_function(physical_properties, fem_properties)
+  {
+    init_buffers(fe);
+  }
+
   FluidScratchData (const FluidScratchData &scratch)
     : FullScratchData<dim>(scratch),
-    fe_vertices_values(scratch.fe_vertices_values.get_fe(),
-  		   scratch.fe_vertices_values.get_quadrature(),
-  		   scratch.fe_vertices_values.get_update_flags()
-		       ),
-    n_vertices_q_points(scratch.n_vertices_q_points)
-      {}
-}; */
+    fluid_stress_values(scratch.fluid_stress_values.physical_properties),
+    fluid_boundary_values_function(scratch.fluid_boundary_values_function.physical_properties,
+				   scratch.fluid_boundary_values_function.fem_properties)
+  {
+    init_buffers(scratch.fe_values.get_fe());
+  }
+
+ private:
+  void init_buffers (const FiniteElement<dim> &fe)
+  {
+    const unsigned int n_components = fe.n_components();
+    old_solution_values.assign(this->n_q_points, Vector<double>(n_components));
+    old_old_solution_values.assign(this->n_q_points, Vector<double>(n_components));
+    u_star_values.assign(this->n_q_points, Vector<double>(n_components));
+    z.assign(this->n_q_points, Vector<double>(n_components));
+
+    grad_u_old.assign(this->n_q_points, Tensor<2,dim,double>());
+    grad_u_old_old.assign(this->n_q_points, Tensor<2,dim,double>());
+    grad_u_star.assign(this->n_q_points, Tensor<2,dim,double>());
+    F.assign(this->n_q_points, Tensor<2,dim,double>());
+    grad_z.assign(this->n_q_points, Tensor<2,dim,double>());
+
+    adjoint_rhs_values.assign(this->n_face_q_points, Vector<double>(n_components));
+    linear_rhs_values.assign(this->n_face_q_points, Vector<double>(n_components));
+    g_stress_values.assign(this->n_face_q_points, Vector<double>(n_components));
+    old_solution_side_values.assign(this->n_face_q_points, Vector<double>(n_components));
+    old_old_solution_side_values.assign(this->n_face_q_points, Vector<double>(n_components));
+    u_star_side_values.assign(this->n_face_q_points, Vector<double>(n_components));
+    stress_values.assign(n_components, Tensor<1,dim,double>());
+    u_true_side_values.reinit(n_components);
+
+    phi_u.assign(fe.dofs_per_cell, Tensor<1,dim,double>());
+    grad_phi_u.assign(fe.dofs_per_cell, Tensor<2,dim,double>());
+    div_phi_u.assign(fe.dofs_per_cell, 0.);
+  }
+};
+
 
 
 #endif
@@ -1,4 +1,8 @@
 #include "FSI_Project.h"
+#include <deal.II/lac/solver_control.h>
+#include <deal.II/lac/solver_gmres.h>
+#include <deal.II/lac/compressed_simple_sparsity_pattern.h>
+#include "linear_maps.h"
 
 template <int dim>
 void FSIProblem<dim>::solve (const SparseDirectUMFPACK& direct_solver, const int block_num, Mode enum_)
@@ -17,7 +21,12 @@ void FSIProblem<dim>::solve (const SparseDirectUMFPACK& direct_solver, const int
     {
       solution_vector=&adjoint_solution;
       rhs_vector=&adjoint_rhs;
+      // with transposed adjoint solves the factors passed in are those of the linearized matrix
+#ifdef FSI_UMFPACK_TRANSPOSED_SOLVE
+      direct_solver.solve(rhs_vector->block(block_num), fem_properties.transposed_adjoint);
+#else
       direct_solver.solve(rhs_vector->block(block_num));
+#endif
       solution_vector->block(block_num) = rhs_vector->block(block_num);
     }
   else // enum_==linear
@@ -44,4 +53,85 @@ void FSIProblem<dim>::solve (const SparseDirectUMFPACK& direct_solver, const int
     }
 }
 
+// Modified Newton step of the fluid or structure state system, assembled with its boundary values
+// at the current iterate, with the factors of an earlier matrix: x += J_old^{-1} (b - A x).
+// The Dirichlet rows have a zero residual and keep their values.
+template <int dim>
+void FSIProblem<dim>::lagged_state_solve (const SparseDirectUMFPACK& direct_solver, const int block_num)
+{
+  Vector<double> update(dofs_per_big_block[block_num]);
+  system_matrix.block(block_num,block_num).residual(update, solution.block(block_num), system_rhs.block(block_num));
+  direct_solver.solve(update);
+  solution.block(block_num) += update;
+
+  switch (block_num)
+    {
+    case 0:
+      fluid_constraints.distribute (solution.block(block_num));
+      break;
+    case 1:
+      structure_constraints.distribute (solution.block(block_num));
+      break;
+    default:
+      AssertThrow(false,ExcNotImplemented());
+    }
+}
+
+template <int dim>
+void FSIProblem<dim>::fluid_block_solve (const SparseMatrix<double> &fluid_matrix, Vector<double> &fluid_solution, const Vector<double> &fluid_rhs,
+					 const bool rebuild_preconditioner)
+{
+  const unsigned int n_u = dofs_per_block[0];
+
+  assemble_fluid_pressure_mass_matrix();
+  if (!fluid_pressure_mass_factored)
+    {
+      fluid_pressure_mass_solver.initialize(fluid_pressure_mass_matrix);
+      fluid_pressure_mass_factored = true;
+    }
+
+  // The velocity block keeps the sparsity of the fluid matrix restricted to velocity
+  // rows and columns; its values are copied from the current fluid matrix
+  if (fluid_velocity_matrix.empty())
+    {
+      const SparsityPattern &fluid_pattern = sparsity_pattern.block(0,0);
+      CompressedSimpleSparsityPattern csp (n_u, n_u);
+      for (unsigned int row=0; row<n_u; ++row)
+	for (SparsityPattern::iterator it=fluid_pattern.begin(row); it!=fluid_pattern.end(row); ++it)
+	  if (it->column()<n_u)
+	    csp.add(row, it->column());
+      fluid_velocity_sparsity_pattern.copy_from(csp);
+      fluid_velocity_matrix.reinit(fluid_velocity_sparsity_pattern);
+    }
+  if (rebuild_preconditioner)
+    {
+      for (unsigned int row=0; row<n_u; ++row)
+	for (SparseMatrix<double>::const_iterator it=fluid_matrix.begin(row); it!=fluid_matrix.end(row); ++it)
+	  if (it->column()<n_u)
+	    fluid_velocity_matrix.set(row, it->column(), it->value());
+#ifdef DEAL_II_WITH_TRILINOS
+      TrilinosWrappers::PreconditionAMG::AdditionalData data;
+      data.elliptic = false;
+      data.higher_order_elements = (fem_properties.fluid_degree>1);
+      fluid_velocity_preconditioner.initialize(fluid_velocity_matrix, data);
+#else
+      fluid_velocity_preconditioner.initialize(fluid_velocity_matrix, SparseILU<double>::AdditionalData());
+#endif
+    }
+
+  LinearMap::FluidBlockPreconditioner<dim> preconditioner(this, fluid_matrix);
+
+  SolverControl solver_control(1000, fem_properties.fluid_linear_tolerance*fluid_rhs.l2_norm());
+  SolverGMRES<Vector<double> > solver (solver_control, SolverGMRES<Vector<double> >::AdditionalData(50, true));
+  solver.solve(fluid_matrix, fluid_solution, fluid_rhs, preconditioner);
+
+  fluid_constraints.distribute (fluid_solution);
+}
+
 template void FSIProblem<2>::solve (const SparseDirectUMFPACK& direct_solver, const int block_num, Mode enum_);
+
+template void FSIProblem<2>::lagged_state_solve (const SparseDirectUMFPACK& direct_solver, const int block_num);
+
+
+template void FSIProblem<2>::fluid_block_solve (const SparseMatrix<double> &fluid_matrix, Vector<double> &fluid_solution, const Vector<double> &fluid_rhs,
+					       const bool rebuild_preconditioner);
@@ -1,4 +1,5 @@
 #include "FSI_Project.h"
+#include <deal.II/lac/compressed_simple_sparsity_pattern.h>
 
 template <int dim>
 void FSIProblem<dim>::build_adjoint_rhs()
@@ -36,6 +37,17 @@ void FSIProblem<dim>::build_adjoint_rhs()
     }
 }
 
+template <int dim>
+const Mapping<dim> & FSIProblem<dim>::fluid_mapping() const
+{
+  // The Eulerian mapping sees the deformed ALE configuration without moving any vertices
+  if (physical_properties.move_domain && physical_properties.eulerian_mapping)
+    {
+      return *fluid_eulerian_mapping;
+    }
+  return StaticMappingQ1<dim>::mapping;
+}
+
 template <int dim>
 void FSIProblem<dim>::get_fluid_stress()
 {
@@ -45,7 +57,7 @@ void FSIProblem<dim>::get_fluid_stress()
   const FEValuesExtractors::Scalar pressure (dim);
 
   QGauss<dim-1> face_quadrature_formula(fem_properties.fluid_degree+2);
-  FEFaceValues<dim> fe_face_values (fluid_fe, face_quadrature_formula,
+  FEFaceValues<dim> fe_face_values (fluid_mapping(), fluid_fe, face_quadrature_formula,
 				    update_values    | update_normal_vectors | update_gradients |
 				    update_quadrature_points  | update_JxW_values);
   const unsigned int   n_face_q_points = face_quadrature_formula.size();
@@ -103,7 +115,7 @@ Tensor<1,dim,double> FSIProblem<dim>::lift_and_drag_fluid()
   const FEValuesExtractors::Scalar pressure (dim);
 
   QGauss<dim-1> face_quadrature_formula(fem_properties.fluid_degree+2);
-  FEFaceValues<dim> fe_face_values (fluid_fe, face_quadrature_formula,
+  FEFaceValues<dim> fe_face_values (fluid_mapping(), fluid_fe, face_quadrature_formula,
 				    update_values    | update_normal_vectors | update_gradients |
 				    update_quadrature_points  | update_JxW_values);
   const unsigned int   n_face_q_points = face_quadrature_formula.size();
@@ -197,9 +209,17 @@ Tensor<1,dim,double> FSIProblem<dim>::lift_and_drag_structure()
 
 template <int dim>
 double FSIProblem<dim>::interface_error()
+{
+  return interface_functional(rhs_for_adjoint.block(0), stress.block(0));
+}
+
+// Objective of the interface jump and the control penalty,
+// 0.5 |jump|^2 + 0.5 epsilon |control|^2 on the interface (no penalty for DN)
+template <int dim>
+double FSIProblem<dim>::interface_functional(const Vector<double> &jump, const Vector<double> &control)
 {
   QGauss<dim-1> face_quadrature_formula(fem_properties.fluid_degree+2);
-  FEFaceValues<dim> fe_face_values (fluid_fe, face_quadrature_formula,
+  FEFaceValues<dim> fe_face_values (fluid_mapping(), fluid_fe, face_quadrature_formula,
 				    update_values    | update_normal_vectors |
 				    update_quadrature_points  | update_JxW_values);
   const unsigned int   n_face_q_points = face_quadrature_formula.size();
@@ -224,9 +244,9 @@ double FSIProblem<dim>::interface_error()
 	      if (fluid_boundaries[cell->face(face_no)->boundary_indicator()]==Interface)
 		{
 		  fe_face_values.reinit (cell, face_no);
-		  fe_face_values.get_function_values (rhs_for_adjoint.block(0), error_values);
+		  fe_face_values.get_function_values (jump, error_values);
 		  if (fem_properties.optimization_method.compare("DN")!=0) {
-		    fe_face_values.get_function_values (stress.block(0), stress_values);
+		    fe_face_values.get_function_values (control, stress_values);
 		  }
 
 		  for (unsigned int q=0; q<n_face_q_points; ++q)
@@ -249,19 +269,52 @@ double FSIProblem<dim>::interface_error()
 }
 
 template <int dim>
-double FSIProblem<dim>::interface_inner_product(const Vector<double>   &values1, const Vector<double>   &values2)
+void FSIProblem<dim>::assemble_interface_mass_matrix()
 {
+  // The reference configuration never changes, so one assembly is enough without ALE motion
+  if (!physical_properties.move_domain && !interface_mass_matrix.empty()) return;
+
+  const std::vector<types::global_dof_index> &interface_dofs = f2n.from;
+  const unsigned int n_interface_dofs = interface_dofs.size();
+  const unsigned int dofs_per_cell = fluid_fe.dofs_per_cell;
+  std::vector<types::global_dof_index> local_dof_indices(dofs_per_cell);
+  // position of each local dof in the interface numbering, or n_interface_dofs if it isn't an interface velocity dof
+  std::vector<unsigned int> local_interface_index(dofs_per_cell);
+
+  if (interface_sparsity_pattern.empty())
+    {
+      CompressedSimpleSparsityPattern csp(n_interface_dofs, n_interface_dofs);
+      typename DoFHandler<dim>::active_cell_iterator
+	cell = fluid_dof_handler.begin_active(),
+	endc = fluid_dof_handler.end();
+      for (; cell!=endc; ++cell)
+	for (unsigned int face_no=0; face_no<GeometryInfo<dim>::faces_per_cell; ++face_no)
+	  if (cell->at_boundary(face_no) && fluid_boundaries[cell->face(face_no)->boundary_indicator()]==Interface)
+	    {
+	      cell->get_dof_indices(local_dof_indices);
+	      for (unsigned int i=0; i<dofs_per_cell; ++i)
+		{
+		  std::vector<types::global_dof_index>::const_iterator it = std::lower_bound(interface_dofs.begin(), interface_dofs.end(), local_dof_indices[i]);
+		  local_interface_index[i] = (it!=interface_dofs.end() && *it==local_dof_indices[i]) ? it-interface_dofs.begin() : n_interface_dofs;
+		}
+	      for (unsigned int i=0; i<dofs_per_cell; ++i)
+		if (local_interface_index[i]<n_interface_dofs)
+		  for (unsigned int j=0; j<dofs_per_cell; ++j)
+		    if (local_interface_index[j]<n_interface_dofs)
+		      csp.add(local_interface_index[i], local_interface_index[j]);
+	    }
+      interface_sparsity_pattern.copy_from(csp);
+      interface_mass_matrix.reinit(interface_sparsity_pattern);
+    }
+
+  interface_mass_matrix = 0;
+
   ale_transform_fluid();
   QGauss<dim-1> face_quadrature_formula(fem_properties.fluid_degree+2);
-  FEFaceValues<dim> fe_face_values (fluid_fe, face_quadrature_formula,
-				    update_values    | update_normal_vectors |
-				    update_quadrature_points  | update_JxW_values);
+  FEFaceValues<dim> fe_face_values (fluid_mapping(), fluid_fe, face_quadrature_formula,
+				    update_values | update_JxW_values);
   const unsigned int   n_face_q_points = face_quadrature_formula.size();
-
-  std::vector<Vector<double> > actual_values(n_face_q_points, Vector<double>(dim+1));
-  std::vector<Vector<double> > premult_values(n_face_q_points, Vector<double>(dim+1));
-
-  double functional = 0;
+  FullMatrix<double> local_mass(dofs_per_cell, dofs_per_cell);
 
   typename DoFHandler<dim>::active_cell_iterator
     cell = fluid_dof_handler.begin_active(),
@@ -277,37 +330,220 @@ double FSIProblem<dim>::interface_inner_product(const Vector<double>   &values1,
 	      if (fluid_boundaries[cell->face(face_no)->boundary_indicator()]==Interface)
 		{
 		  fe_face_values.reinit (cell, face_no);
-		  fe_face_values.get_function_values (values2, actual_values);
-		  fe_face_values.get_function_values (values1, premult_values);
-
-		  for (unsigned int q=0; q<n_face_q_points; ++q)
+		  cell->get_dof_indices(local_dof_indices);
+		  for (unsigned int i=0; i<dofs_per_cell; ++i)
 		    {
-		      Tensor<1,dim,double> pval, val;
-		      for (unsigned int d=0; d<dim; ++d)
+		      std::vector<types::global_dof_index>::const_iterator it = std::lower_bound(interface_dofs.begin(), interface_dofs.end(), local_dof_indices[i]);
+		      local_interface_index[i] = (it!=interface_dofs.end() && *it==local_dof_indices[i]) ? it-interface_dofs.begin() : n_interface_dofs;
+		    }
+		  local_mass = 0;
+		  for (unsigned int i=0; i<dofs_per_cell; ++i)
+		    {
+		      if (local_interface_index[i]==n_interface_dofs) continue;
+		      const unsigned int component_i = fluid_fe.system_to_component_index(i).first;
+		      for (unsigned int j=0; j<dofs_per_cell; ++j)
 			{
-			  pval[d] = premult_values[q](d);
-			  val[d] = actual_values[q](d);
+			  if (local_interface_index[j]==n_interface_dofs) continue;
+			  if (fluid_fe.system_to_component_index(j).first!=component_i) continue;
+			  for (unsigned int q=0; q<n_face_q_points; ++q)
+			    local_mass(i,j) += fe_face_values.shape_value(i,q) * fe_face_values.shape_value(j,q) * fe_face_values.JxW(q);
 			}
-		      functional += pval * val * fe_face_values.JxW(q); 
 		    }
+		  for (unsigned int i=0; i<dofs_per_cell; ++i)
+		    if (local_interface_index[i]<n_interface_dofs)
+		      for (unsigned int j=0; j<dofs_per_cell; ++j)
+			if (local_interface_index[j]<n_interface_dofs)
+			  interface_mass_matrix.add(local_interface_index[i], local_interface_index[j], local_mass(i,j));
 		}
 	    }
 	}
     }
   ref_transform_fluid();
-  return functional;
 }
 
 template <int dim>
-double FSIProblem<dim>::interface_norm(const Vector<double>   &values)
+void FSIProblem<dim>::assemble_structure_interface_mass_matrix()
+{
+  // Called from assemble_structure so that the faces are in the configuration of its interface terms
+  const std::vector<types::global_dof_index> &interface_dofs = structure_interface_dofs;
+  const unsigned int n_interface_dofs = interface_dofs.size();
+  const unsigned int dofs_per_cell = structure_fe.dofs_per_cell;
+  std::vector<types::global_dof_index> local_dof_indices(dofs_per_cell);
+  std::vector<unsigned int> local_interface_index(dofs_per_cell);
+
+  if (structure_interface_sparsity_pattern.empty())
+    {
+      CompressedSimpleSparsityPattern csp(n_interface_dofs, n_interface_dofs);
+      typename DoFHandler<dim>::active_cell_iterator
+	cell = structure_dof_handler.begin_active(),
+	endc = structure_dof_handler.end();
+      for (; cell!=endc; ++cell)
+	for (unsigned int face_no=0; face_no<GeometryInfo<dim>::faces_per_cell; ++face_no)
+	  if (cell->at_boundary(face_no) && structure_boundaries[cell->face(face_no)->boundary_indicator()]==Interface)
+	    {
+	      cell->get_dof_indices(local_dof_indices);
+	      for (unsigned int i=0; i<dofs_per_cell; ++i)
+		{
+		  std::vector<types::global_dof_index>::const_iterator it = std::lower_bound(interface_dofs.begin(), interface_dofs.end(), local_dof_indices[i]);
+		  local_interface_index[i] = (it!=interface_dofs.end() && *it==local_dof_indices[i]) ? it-interface_dofs.begin() : n_interface_dofs;
+		}
+	      for (unsigned int i=0; i<dofs_per_cell; ++i)
+		if (local_interface_index[i]<n_interface_dofs)
+		  for (unsigned int j=0; j<dofs_per_cell; ++j)
+		    if (local_interface_index[j]<n_interface_dofs)
+		      csp.add(local_interface_index[i], local_interface_index[j]);
+	    }
+      structure_interface_sparsity_pattern.copy_from(csp);
+      structure_interface_mass_matrix.reinit(structure_interface_sparsity_pattern);
+    }
+
+  structure_interface_mass_matrix = 0;
+
+  QGauss<dim-1> face_quadrature_formula(fem_properties.structure_degree+2);
+  FEFaceValues<dim> fe_face_values (structure_fe, face_quadrature_formula,
+				    update_values | update_JxW_values);
+  const unsigned int   n_face_q_points = face_quadrature_formula.size();
+  FullMatrix<double> local_mass(dofs_per_cell, dofs_per_cell);
+
+  typename DoFHandler<dim>::active_cell_iterator
+    cell = structure_dof_handler.begin_active(),
+    endc = structure_dof_handler.end();
+  for (; cell!=endc; ++cell)
+    for (unsigned int face_no=0; face_no<GeometryInfo<dim>::faces_per_cell; ++face_no)
+      if (cell->at_boundary(face_no) && structure_boundaries[cell->face(face_no)->boundary_indicator()]==Interface)
+	{
+	  fe_face_values.reinit (cell, face_no);
+	  cell->get_dof_indices(local_dof_indices);
+	  for (unsigned int i=0; i<dofs_per_cell; ++i)
+	    {
+	      std::vector<types::global_dof_index>::const_iterator it = std::lower_bound(interface_dofs.begin(), interface_dofs.end(), local_dof_indices[i]);
+	      local_interface_index[i] = (it!=interface_dofs.end() && *it==local_dof_indices[i]) ? it-interface_dofs.begin() : n_interface_dofs;
+	    }
+	  local_mass = 0;
+	  for (unsigned int i=0; i<dofs_per_cell; ++i)
+	    {
+	      if (local_interface_index[i]==n_interface_dofs) continue;
+	      const unsigned int component_i = structure_fe.system_to_component_index(i).first;
+	      for (unsigned int j=0; j<dofs_per_cell; ++j)
+		{
+		  if (local_interface_index[j]==n_interface_dofs) continue;
+		  if (structure_fe.system_to_component_index(j).first!=component_i) continue;
+		  for (unsigned int q=0; q<n_face_q_points; ++q)
+		    local_mass(i,j) += fe_face_values.shape_value(i,q) * fe_face_values.shape_value(j,q) * fe_face_values.JxW(q);
+		}
+	    }
+	  for (unsigned int i=0; i<dofs_per_cell; ++i)
+	    if (local_interface_index[i]<n_interface_dofs)
+	      for (unsigned int j=0; j<dofs_per_cell; ++j)
+		if (local_interface_index[j]<n_interface_dofs)
+		  structure_interface_mass_matrix.add(local_interface_index[i], local_interface_index[j], local_mass(i,j));
+	}
+}
+
+template <int dim>
+void FSIProblem<dim>::assemble_interface_rhs(Mode enum_)
+{
+  // The linearized and adjoint right hand sides only hold the interface terms
+  // theta*(phi_i, h)_interface, so they follow from the face mass matrices
+  // without a cell loop. Data outside the interface dofs is zero.
+  AssertThrow(enum_!=state, ExcNotImplemented());
+  const BlockVector<double> &interface_data = (enum_==adjoint) ? rhs_for_adjoint : rhs_for_linear;
+  BlockVector<double> &rhs = (enum_==adjoint) ? adjoint_rhs : linear_rhs;
+
+  const unsigned int n_fluid_interface_dofs = f2n.size();
+  Vector<double> fluid_values(n_fluid_interface_dofs), fluid_terms(n_fluid_interface_dofs);
+  for (unsigned int k=0; k<n_fluid_interface_dofs; ++k)
+    fluid_values(k) = interface_data.block(0)(f2n.from[k]);
+  interface_mass_matrix.vmult(fluid_terms, fluid_values);
+  rhs.block(0) = 0;
+  for (unsigned int k=0; k<n_fluid_interface_dofs; ++k)
+    rhs.block(0)(f2n.from[k]) = fem_properties.fluid_theta*fluid_terms(k);
+
+  // The mass matrix couples equal components, so displacement data is tested with the
+  // displacements and velocity data (adjoint_type!=1) with the velocities
+  const unsigned int n_structure_interface_dofs = structure_interface_dofs.size();
+  Vector<double> structure_values(n_structure_interface_dofs), structure_terms(n_structure_interface_dofs);
+  for (unsigned int k=0; k<n_structure_interface_dofs; ++k)
+    structure_values(k) = interface_data.block(1)(structure_interface_dofs[k]);
+  structure_interface_mass_matrix.vmult(structure_terms, structure_values);
+  rhs.block(1) = 0;
+  for (unsigned int k=0; k<n_structure_interface_dofs; ++k)
+    rhs.block(1)(structure_interface_dofs[k]) = fem_properties.structure_theta*structure_terms(k);
+}
+
+template <int dim>
+double FSIProblem<dim>::interface_inner_product(const Vector<double>   &values1, const Vector<double>   &values2) const
+{
+  // Only the interface velocity dofs have a trace on the interface,
+  // so the face integral reduces to the interface mass matrix
+  const unsigned int n_interface_dofs = f2n.size();
+  Vector<double> interface_values1(n_interface_dofs), interface_values2(n_interface_dofs);
+  for (unsigned int k=0; k<n_interface_dofs; ++k)
+    {
+      interface_values1(k) = values1(f2n.from[k]);
+      interface_values2(k) = values2(f2n.from[k]);
+    }
+  return interface_mass_matrix.matrix_scalar_product(interface_values1, interface_values2);
+}
+
+template <int dim>
+double FSIProblem<dim>::interface_norm(const Vector<double>   &values) const
 {
   return std::sqrt(interface_inner_product(values, values));
 }
 
+template <int dim>
+void FSIProblem<dim>::update_coupling_iterate(const BlockVector<double> &previous_iterate)
+{
+  // solution.block(1) holds the output of the structure solve for the interface data of previous_iterate
+  if (fem_properties.coupling_acceleration.compare("constant")==0)
+    {
+      solution.block(1) *= fem_properties.steepest_descent_alpha;
+      solution.block(1).add(1-fem_properties.steepest_descent_alpha, previous_iterate.block(1));
+    }
+  else
+    {
+      // Only the interface values enter the fluid solve, so only those are accelerated
+      const unsigned int n_interface_dofs = structure_interface_dofs.size();
+      Vector<double> x(n_interface_dofs), x_tilde(n_interface_dofs), x_new(n_interface_dofs);
+      for (unsigned int k=0; k<n_interface_dofs; ++k)
+	{
+	  x(k) = previous_iterate.block(1)(structure_interface_dofs[k]);
+	  x_tilde(k) = solution.block(1)(structure_interface_dofs[k]);
+	}
+      coupling_accelerator.update(x, x_tilde, x_new);
+      for (unsigned int k=0; k<n_interface_dofs; ++k)
+	solution.block(1)(structure_interface_dofs[k]) = x_new(k);
+    }
+  solution_star.block(1) = solution.block(1);
+}
+
+template <int dim>
+double FSIProblem<dim>::coupling_inner_product(const Vector<double> &values1, const Vector<double> &values2) const
+{
+  // Values on structure_interface_dofs; the interface velocity follows from the displacement
+  // through the structure time stepping, so the displacement trace alone is weighted
+  const unsigned int n_interface_dofs = f2n.size();
+  Vector<double> interface_values1(n_interface_dofs), interface_values2(n_interface_dofs);
+  for (unsigned int k=0; k<n_interface_dofs; ++k)
+    {
+      interface_values1(k) = values1(interface_displacement_index[k]);
+      interface_values2(k) = values2(interface_displacement_index[k]);
+    }
+  return interface_mass_matrix.matrix_scalar_product(interface_values1, interface_values2);
+}
+
+template const Mapping<2> & FSIProblem<2>::fluid_mapping() const;
 template void FSIProblem<2>::build_adjoint_rhs();
 template void FSIProblem<2>::get_fluid_stress();
 template Tensor<1,2,double> FSIProblem<2>::lift_and_drag_fluid();
 template Tensor<1,2,double> FSIProblem<2>::lift_and_drag_structure();
 template double FSIProblem<2>::interface_error();
-template double FSIProblem<2>::interface_inner_product(const Vector<double>  &values1, const Vector<double>  &values2);
-template double FSIProblem<2>::interface_norm(const Vector<double>   &values);
+template double FSIProblem<2>::interface_functional(const Vector<double> &jump, const Vector<double> &control);
+template void FSIProblem<2>::update_coupling_iterate(const BlockVector<double> &previous_iterate);
+template double FSIProblem<2>::coupling_inner_product(const Vector<double> &values1, const Vector<double> &values2) const;
+template void FSIProblem<2>::assemble_interface_mass_matrix();
+template void FSIProblem<2>::assemble_structure_interface_mass_matrix();
+template void FSIProblem<2>::assemble_interface_rhs(Mode enum_);
+template double FSIProblem<2>::interface_inner_product(const Vector<double>  &values1, const Vector<double>  &values2) const;
+template double FSIProblem<2>::interface_norm(const Vector<double>   &values) const;